@@ -1,503 +1,695 @@
-#include "assembler.h"
-#include "token.h"
-#include "utils.h"
-#include <fstream>
-#include <stdexcept>
-#include <iostream>
-#include <regex>
-#include <unordered_map>
-#include <unordered_set>
-#include <sstream>
-#include <iterator>
-#include <vector>
-#include <string>
-#include <cctype>
-#include <stack>
-
-// Funções utilitárias
-std::string Assembler::removeComments(const std::string &line)
-{
-    size_t commentPos = line.find(';');
-    if (commentPos != std::string::npos)
-    {
-        return line.substr(0, commentPos);
-    }
-    return line;
-}
-
-std::string Assembler::removeExtraSpaces(const std::string &line)
-{
-    std::string result;
-    std::unique_copy(line.begin(), line.end(), std::back_insert_iterator<std::string>(result),
-                     [](char a, char b)
-                     { return isspace(a) && isspace(b); });
-    return result;
-}
-
-std::vector<std::string> Assembler::tokenize(const std::string &line)
-{
-    std::vector<std::string> tokens;
-    std::string token;
-    std::istringstream iss(line);
-    char ch;
-
-    while (iss.get(ch))
-    {
-        if (ch == ' ' || ch == '\t' || ch == ',')
-        {
-            if (!token.empty())
-            {
-                tokens.push_back(token);
-                token.clear();
-            }
-        }
-        else
-        {
-            token.push_back(ch);
-        }
-    }
-
-    if (!token.empty())
-    {
-        tokens.push_back(token);
-    }
-
-    return tokens;
-}
-
-void Assembler::parseTokens(const std::vector<std::string> &tokens, std::string &label, std::string &opcode, std::vector<std::string> &operands)
-{
-    if (tokens.empty())
-        return;
-
-    size_t i = 0;
-
-    if (tokens[i].back() == ':')
-    {
-        label = tokens[i].substr(0, tokens[i].size() - 1);
-        ++i;
-    }
-
-    if (i < tokens.size())
-    {
-        opcode = tokens[i++];
-    }
-
-    while (i < tokens.size())
-    {
-        operands.push_back(tokens[i++]);
-    }
-}
-
-bool Assembler::isValidLabel(const std::string &label)
-{
-    return std::regex_match(label, std::regex("^[A-Za-z_][A-Za-z0-9_]*$"));
-}
-
-bool Assembler::isValidOpcode(const std::string &opcode)
-{
-    static const std::unordered_set<std::string> validOpcodes = {
-        "ADD", "SUB", "MULT", "DIV", "JMP", "JMPN", "JMPP", "JMPZ", "COPY",
-        "LOAD", "STORE", "INPUT", "OUTPUT", "STOP", "SECTION", "SPACE", "CONST", "BEGIN", "END"};
-
-    return validOpcodes.find(opcode) != validOpcodes.end();
-}
-
-bool Assembler::isValidDirective(const std::string &directive)
-{
-    static const std::unordered_set<std::string> validDirectives = {
-        "BEGIN", "END", "EXTERN", "PUBLIC"};
-
-    return validDirectives.find(directive) != validDirectives.end();
-}
-
-bool Assembler::hasCorrectNumberOfOperands(const std::string &opcode, size_t numOperands)
-{
-    static const std::unordered_map<std::string, size_t> opcodeOperands = {
-        {"ADD", 1}, {"SUB", 1}, {"MULT", 1}, {"DIV", 1}, {"JMP", 1}, {"JMPN", 1}, {"JMPP", 1}, {"JMPZ", 1}, {"COPY", 2}, {"LOAD", 1}, {"STORE", 1}, {"INPUT", 1}, {"OUTPUT", 1}, {"STOP", 0}, {"SPACE", 0}, {"CONST", 1}, {"BEGIN", 0}, {"END", 0}};
-
-    auto it = opcodeOperands.find(opcode);
-    return it != opcodeOperands.end() && it->second == numOperands;
-}
-
-int Assembler::getOpcodeValue(const std::string &opcode)
-{
-    static const std::unordered_map<std::string, int> opcodeValues = {
-        {"ADD", 1}, {"SUB", 2}, {"MULT", 3}, {"DIV", 4}, {"JMP", 5}, {"JMPN", 6}, {"JMPP", 7}, {"JMPZ", 8}, {"COPY", 9}, {"LOAD", 10}, {"STORE", 11}, {"INPUT", 12}, {"OUTPUT", 13}, {"STOP", 14}};
-
-    auto it = opcodeValues.find(opcode);
-    if (it != opcodeValues.end())
-    {
-        return it->second;
-    }
-    throw std::runtime_error("Invalid opcode: " + opcode);
-}
-
-bool Assembler::isValidImmediateValue(const std::string &operand)
-{
-    return std::regex_match(operand, std::regex("^\\d+$"));
-}
-struct SymbolInfo
-{
-    int address;
-    bool isExtern;
-    bool isResolved;
-};
-
-void Assembler::assemble(const std::string &inputFile, const std::string &finalOutputFile)
-{
-    std::ifstream input(inputFile);
-    std::ostringstream tempOutput;
-    std::ofstream finalOutput(finalOutputFile);
-    std::string line;
-    int locationCounter = 0;
-    std::unordered_map<std::string, SymbolInfo> symbolTable;             // Tabela de símbolos com informações adicionais
-    std::unordered_map<std::string, int> definitionTable;                // Tabela de definições
-    std::unordered_map<std::string, std::vector<int>> usageTable;        // Tabela de uso
-    std::unordered_map<std::string, std::vector<int>> pendingReferences; // Referências pendentes
-    bool hasBegin = false;
-    bool hasEnd = false;
-
-    // Primeira Passagem: Montagem inicial
-    std::cout << "First pass:" << std::endl;
-    while (std::getline(input, line))
-    {
-        line = removeComments(line);
-        line = removeExtraSpaces(line);
-        if (line.empty())
-            continue;
-
-        std::vector<std::string> tokens = tokenize(line);
-        std::string label, opcode;
-        std::vector<std::string> operands;
-        std::regex opRegex("[+\\-*/]");
-
-        parseTokens(tokens, label, opcode, operands);
-
-        // Printar a tabela de símbolos
-        std::cout << "\n\n Symbol Table:" << std::endl;
-        for (const auto& symbol : symbolTable) {
-            std::cout << "Label: " << symbol.first << ", Address: " << symbol.second.address << ", Extern: " << symbol.second.isExtern << std::endl;
-        }
-        // Printar tabela de definições
-        std::cout << "\n\n Definition Table:" << std::endl;
-        for (const auto& symbol : definitionTable) {
-            std::cout << "Label: " << symbol.first << ", Address: " << symbol.second << std::endl;
-        }
-        // Printar tabela de uso
-        std::cout << "\n\n Usage Table:" << std::endl;
-        for (const auto& symbol : usageTable) {
-            std::cout << "Label: " << symbol.first << ", Address: ";
-            for (const auto& address : symbol.second) {
-                std::cout << address << " ";
-            }
-            std::cout << std::endl;
-        }
-        // Printar referências pendentes
-        std::cout << "\n\n Pending References:" << std::endl;
-        for (const auto& symbol : pendingReferences) {
-            std::cout << "Label: " << symbol.first << ", Address: ";
-            for (const auto& address : symbol.second) {
-                std::cout << address << " ";
-            }
-            std::cout << std::endl;
-        }
-
-        // Processar rótulo
-        if (!label.empty())
-        {
-            if (!isValidLabel(label))
-                throw std::runtime_error("Error: Invalid label: " + label);
-
-            std::cout << "Processing label: " << label << std::endl;
-
-            if (opcode == "BEGIN")
-            {
-                std::cout << "Found BEGIN directive." << std::endl;
-                hasBegin = true;
-                symbolTable[label] = {locationCounter, false, true};
-                definitionTable[label] = locationCounter;
-                continue;
-            }
-            else if (opcode == "EXTERN")
-            {
-                std::cout << "Found EXTERN directive." << std::endl;
-                if (symbolTable.find(label) != symbolTable.end())
-                    throw std::runtime_error("Error: Redefinition of symbol: " + label);
-
-                symbolTable[label] = {locationCounter, true}; // Endereço 0 e externo
-                continue;                                     // Não processa como instrução
-            }
-            else if (opcode == "SPACE")
-            {
-                symbolTable[label] = {locationCounter, false}; // Endereço atual e não externo
-                std::cout << "Processing SPACE directive." << std::endl;
-                for (const auto &operand : operands)
-                {
-                    std::cout << "Operand: " << operand << std::endl;
-                }
-                if (!operands.empty())
-                {
-                    if (!isValidImmediateValue(operands[0]))
-                        throw std::runtime_error("Error: Invalid operand for SPACE directive: " + operands[0]);
-                    int spaceSize = std::stoi(operands[0]);
-                    for (int i = 0; i < spaceSize; ++i)
-                    {
-                        tempOutput << "00 ";
-                        locationCounter++;
-                    }
-                }
-                else
-                {
-                    throw std::runtime_error("Error: Missing operand for SPACE directive.");
-                }
-            }
-            else if (opcode == "STOP")
-            {
-                std::cout << "Processing STOP directive." << std::endl;
-                int opcodeValue = getOpcodeValue(opcode);
-                tempOutput << opcodeValue << " ";
-                locationCounter++;
-            }
-            else if (opcode == "CONST")
-            {
-                std::cout << "Processing CONST directive." << std::endl;
-                tempOutput << operands[0] << " ";
-                symbolTable[label] = {locationCounter, false}; // Endereço atual e não externo
-                definitionTable[label] = locationCounter;
-                locationCounter++;
-            }
-            else
-            {
-                std::cout << "Processing label without specific directive." << std::endl;
-                symbolTable[label] = {locationCounter, false}; // Endereço atual e não externo
-            }
-        }
-        else if (opcode == "END")
-        {
-            std::cout << "Found END directive." << std::endl;
-            hasEnd = true;
-            continue; // Não processa como instrução
-        }
-        else if (opcode == "PUBLIC")
-        {
-            std::cout << "Found PUBLIC directive." << std::endl;
-            for (const auto &operand : operands)
-            {
-                definitionTable[operand] = {};
-            }
-            continue; // Não processa como instrução
-        }
-        else if (std::regex_search(line, opRegex))
-        {
-            std::cout << "Processing EXPRESSION instruction for " << opcode << std::endl;
-            int opcodeValue = getOpcodeValue(opcode);
-            tempOutput << opcodeValue << " ";
-            locationCounter++;
-
-            std::cout << "operands: " << operands[0] << " and " << operands[2] << std::endl;
-
-            if (symbolTable.find(operands[0]) != symbolTable.end())
-            {
-                std::cout << "Processing expression token adress: " << symbolTable[operands[0]].address << std::endl;
-                int op_0 = symbolTable[operands[0]].address;
-                int op_2 = std::stoi(operands[2]);
-                char op = operands[1][0];
-                switch (op)
-                {
-                case '+':
-                    tempOutput << op_0 + op_2 << " ";
-                    break;
-                case '-':
-                    tempOutput << op_0 - op_2 << " ";
-                    break;
-                case '*':
-                    tempOutput << op_0 * op_2 << " ";
-                    break;
-                case '/':
-                    if (op_0 % op_2 != 0)
-                    {
-                        throw std::runtime_error("Error: Invalid division: " + std::to_string(op_0) + " / " + std::to_string(op_2));
-                    }
-                    tempOutput << op_0 / op_2 << " ";
-                    break;
-                default:
-                    throw std::runtime_error("Error: Invalid operator: " + std::string(1, op));
-                }
-                if (symbolTable[operands[0]].isExtern)
-                        usageTable[operands[0]].push_back(locationCounter);
-            }
-            else
-            {
-                std::cout << "Adding pending reference for EXPRESSION operands: " << operands[0] << std::endl;
-                // Adiciona referência pendente
-                pendingReferences[operands[0]].push_back(locationCounter);
-                std::cout << "EXPRESSION operands: " << operands[0] << " and " << operands[2] << std::endl;
-                std::cout << "EXPRESSION operator: " << operands[1] << std::endl;
-                if (symbolTable[operands[0]].isExtern)
-                        usageTable[operands[0]].push_back(locationCounter);
-                tempOutput << "EXP" << operands[1] << operands[2] << " "; // Coloca XX para referências não resolvidas
-            }
-            locationCounter++;
-        }
-        else
-        {
-            std::cout << "Processing general instruction: " << opcode << "in location counter: " << locationCounter << std::endl;
-            int opcodeValue = getOpcodeValue(opcode);
-            tempOutput << opcodeValue << " ";
-            locationCounter++;
-
-            for (const auto &operand : operands)
-            {
-                if (symbolTable.find(operand) != symbolTable.end())
-                {
-                    tempOutput << symbolTable[operand].address << " ";
-                    std::cout << symbolTable[operand].isExtern << std::endl;
-                    if (symbolTable[operand].isExtern)
-                        usageTable[operand].push_back(locationCounter);
-                }
-                else if (isValidImmediateValue(operand))
-                {
-                    std::cout << "Processing immediate value: " << operand << std::endl;
-                    tempOutput << operand << " ";
-                }
-                else
-                {
-                    std::cout << "Adding pending reference for operand: " << operand << "in location counter: " << locationCounter << std::endl;
-                    // Adiciona referência pendente
-                    pendingReferences[operand].push_back(locationCounter);
-                    tempOutput << "XX "; // Coloca XX para referências não resolvidas
-                }
-                locationCounter++;
-            }
-        }
-    }
-
-    if ((hasBegin && !hasEnd) || (!hasBegin && hasEnd))
-    {
-        throw std::runtime_error("Error: Missing BEGIN or END directive.");
-    }
-
-    input.close();
-
-    // Segunda Passagem: Substituição de referências pendentes
-    std::istringstream tempInput(tempOutput.str());
-    locationCounter = 0;
-    std::regex pattern("^EXP");
-    std::cout << "Second pass: Resolving pending references." << std::endl;
-    while (std::getline(tempInput, line))
-    {
-        std::istringstream iss(line);
-        std::string token;
-        while (iss >> token)
-        {
-            if (token == "XX")
-            { // Verifica se é uma referência pendente
-                bool resolved = false;
-                for (const auto &[operand, refs] : pendingReferences)
-                {
-                    if (symbolTable.find(operand) != symbolTable.end() && !symbolTable[operand].isExtern)
-                    {
-                        int symbolValue = symbolTable[operand].address;
-                        for (int refPos : refs)
-                        {
-                            if (locationCounter == refPos)
-                            {
-                                finalOutput << symbolValue << " ";
-                                definitionTable[operand] = symbolValue;
-                                std::cout << "Resolved pending reference for symbol: " << operand << " at position " << refPos << " with value " << symbolValue << std::endl;
-                                resolved = true;
-                                break;
-                            }
-                        }
-                        if (resolved)
-                            break;
-                    }
-                }
-                if (!resolved)
-                {
-                    std::cout << "Unresolved reference at position " << locationCounter << ". Using default value 00." << std::endl;
-                    finalOutput << "00 "; // Caso não tenha sido resolvido, coloca zero
-                }
-            }
-            else if (std::regex_search(token, pattern))
-            {
-                bool resolved = false;
-                for (const auto &[operand, refs] : pendingReferences)
-                {
-                    if (symbolTable.find(operand) != symbolTable.end() && !symbolTable[operand].isExtern)
-                    {
-                        int symbolValue = symbolTable[operand].address;
-                        for (int refPos : refs)
-                        {
-                            if (locationCounter == refPos)
-                            {
-                                std::cout << "Processing expression token: " << token << std::endl;
-                                std::cout << "SymbolValue: " << symbolValue << std::endl;
-                                int op_0 = symbolValue;
-                                int op_2 = std::stoi(token.substr(4));
-                                char op = token[3];
-                                switch (op)
-                                {
-                                case '+':
-                                    finalOutput << op_0 + op_2 << " ";
-                                    break;
-                                case '-':
-                                    finalOutput << op_0 - op_2 << " ";
-                                    break;
-                                case '*':
-                                    finalOutput << op_0 * op_2 << " ";
-                                    break;
-                                case '/':
-                                    if (op_0 % op_2 != 0)
-                                    {
-                                        throw std::runtime_error("Error: Invalid division: " + std::to_string(op_0) + " / " + std::to_string(op_2));
-                                    }
-                                    finalOutput << op_0 / op_2 << " ";
-                                    break;
-                                default:
-                                    throw std::runtime_error("Error: Invalid operator: " + std::string(1, op));
-                                }
-                                resolved = true;
-                                break;
-                            }
-                        }
-                        if (resolved)
-                            break;
-                    }
-                }
-            }
-            else
-            {
-                std::cout << "Writing token: " << token << std::endl;
-                finalOutput << token << " ";
-            }
-            locationCounter++;
-        }
-        finalOutput << std::endl;
-    }
-
-    // Escreve a tabela de definições no final do arquivo de saída
-    std::cout << "Writing definition table to output file." << std::endl;
-    finalOutput << "DEFINITION TABLE:" << std::endl;
-    for (const auto &[symbol, address] : definitionTable)
-    {
-        std::cout << "Definition: " << symbol << " " << address << std::endl;
-        finalOutput << symbol << " " << address << std::endl;
-    }
-
-    // Escreve a tabela de uso no final do arquivo de saída
-    std::cout << "Writing usage table to output file." << std::endl;
-    finalOutput << "USAGE TABLE:" << std::endl;
-    for (const auto &[symbol, refs] : usageTable)
-    {
-        finalOutput << symbol << " ";
-        for (const auto &ref : refs)
-        {
-            std::cout << "Usage: " << symbol << " " << ref << std::endl;
-            finalOutput << ref << " ";
-        }
-        finalOutput << std::endl;
-    }
-    finalOutput.close();
-}
+#include "assembler.h"
+#include "isa.h"
+#include "lexer.h"
+#include "token.h"
+#include "utils.h"
+#include "optimizer.h"
+#include "stats.h"
+#include <fstream>
+#include <stdexcept>
+#include <iostream>
+#include <unordered_map>
+#include <unordered_set>
+#include <sstream>
+#include <iterator>
+#include <vector>
+#include <string>
+#include <cctype>
+#include <stack>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <chrono>
+
+namespace
+{
+    bool sectionNamed(const std::string &name, Section &section)
+    {
+        if (name == "TEXT")
+            section = TextSection;
+        else if (name == "DATA")
+            section = DataSection;
+        else
+            return false;
+        return true;
+    }
+}
+
+// Funções utilitárias
+std::string Assembler::removeComments(const std::string &line)
+{
+    size_t commentPos = line.find(';');
+    if (commentPos != std::string::npos)
+    {
+        return line.substr(0, commentPos);
+    }
+    return line;
+}
+
+std::string Assembler::removeExtraSpaces(const std::string &line)
+{
+    std::string result;
+    std::unique_copy(line.begin(), line.end(), std::back_insert_iterator<std::string>(result),
+                     [](char a, char b)
+                     { return isspace(a) && isspace(b); });
+    return result;
+}
+
+std::vector<std::string> Assembler::tokenize(const std::string &line)
+{
+    std::vector<std::string> tokens;
+    size_t position = 0;
+    for (std::string_view token = Lexer::nextToken(line, position); !token.empty(); token = Lexer::nextToken(line, position))
+    {
+        tokens.emplace_back(token);
+    }
+    return tokens;
+}
+
+void Assembler::parseTokens(const std::vector<std::string> &tokens, std::string &label, std::string &opcode, std::vector<std::string> &operands)
+{
+    if (tokens.empty())
+        return;
+
+    size_t i = 0;
+
+    if (tokens[i].back() == ':')
+    {
+        label = tokens[i].substr(0, tokens[i].size() - 1);
+        ++i;
+    }
+
+    if (i < tokens.size())
+    {
+        opcode = tokens[i++];
+    }
+
+    while (i < tokens.size())
+    {
+        operands.push_back(tokens[i++]);
+    }
+}
+
+bool Assembler::isValidLabel(const std::string &label)
+{
+    return Lexer::isLabel(label);
+}
+
+bool Assembler::isValidOpcode(const std::string &opcode)
+{
+    static const std::unordered_set<std::string> validOpcodes = {
+        "ADD", "SUB", "MULT", "DIV", "JMP", "JMPN", "JMPP", "JMPZ", "COPY",
+        "LOAD", "STORE", "INPUT", "OUTPUT", "STOP", "SECTION", "SPACE", "CONST", "BEGIN", "END"};
+
+    return validOpcodes.find(opcode) != validOpcodes.end();
+}
+
+bool Assembler::isValidDirective(const std::string &directive)
+{
+    static const std::unordered_set<std::string> validDirectives = {
+        "BEGIN", "END", "EXTERN", "PUBLIC"};
+
+    return validDirectives.find(directive) != validDirectives.end();
+}
+
+bool Assembler::hasCorrectNumberOfOperands(const std::string &opcode, size_t numOperands)
+{
+    static const std::unordered_map<std::string, size_t> opcodeOperands = {
+        {"ADD", 1}, {"SUB", 1}, {"MULT", 1}, {"DIV", 1}, {"JMP", 1}, {"JMPN", 1}, {"JMPP", 1}, {"JMPZ", 1}, {"COPY", 2}, {"LOAD", 1}, {"STORE", 1}, {"INPUT", 1}, {"OUTPUT", 1}, {"STOP", 0}, {"SPACE", 0}, {"CONST", 1}, {"BEGIN", 0}, {"END", 0}, {"SECTION", 1}};
+
+    auto it = opcodeOperands.find(opcode);
+    return it != opcodeOperands.end() && it->second == numOperands;
+}
+
+int Assembler::getOpcodeValue(const std::string &opcode)
+{
+    if (const InstructionInfo *info = Isa::lookup(opcode))
+    {
+        return info->opcode;
+    }
+    throw std::runtime_error("Invalid opcode: " + opcode);
+}
+
+bool Assembler::isValidImmediateValue(const std::string &operand)
+{
+    return Lexer::isNumber(operand);
+}
+void Assembler::setOptimize(bool enabled)
+{
+    optimize = enabled;
+}
+
+// Destino das mensagens de depuração da montagem (padrão: nenhum)
+void Assembler::setTrace(std::ostream &stream)
+{
+    trace = &stream;
+}
+
+const OptimizerStats &Assembler::getOptimizerStats() const
+{
+    return optimizerStats;
+}
+
+void Assembler::assemble(const std::string &inputFile, const std::string &finalOutputFile)
+{
+    std::ifstream input(inputFile);
+    if (!input)
+        throw std::runtime_error("Error: Could not open input file: " + inputFile);
+    std::ofstream finalOutput(finalOutputFile);
+    assemble(input, finalOutput);
+    finalOutput.close();
+}
+
+void Assembler::setThreads(unsigned count)
+{
+    threads = std::max(1u, count);
+}
+
+// Só para testes: trechos pequenos exercitam as fronteiras da montagem paralela
+void Assembler::setMinimumChunkLines(size_t lines)
+{
+    minimumChunkLines = std::max<size_t>(1, lines);
+}
+
+// Primeira passagem sobre as linhas [begin, end): endereços locais a partir de 0, todas as
+// referências a símbolos ficam pendentes para a segunda passagem
+void Assembler::firstPass(const std::vector<std::string> &lines, size_t begin, size_t end, FirstPassResult &result, std::ostream &log)
+{
+    std::unordered_map<std::string, size_t> localSymbols;
+
+    auto define = [&](const std::string &name, const SymbolInfo &info, size_t lineIndex)
+    {
+        if (localSymbols.find(name) != localSymbols.end())
+            throw std::runtime_error("Error: Redefinition of symbol: " + name);
+        localSymbols[name] = result.symbols.size();
+        result.symbols.push_back({name, info, lineIndex, result.section});
+    };
+
+    bool timed = Stats::enabled();
+    for (size_t lineIndex = begin; lineIndex < end; ++lineIndex)
+    {
+        result.line = lineIndex;
+        std::string line, label, opcode;
+        std::vector<std::string> operands;
+        {
+            PhaseScope phase("lex");
+            auto lexStart = timed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+            line = removeExtraSpaces(removeComments(lines[lineIndex]));
+            if (line.empty() || line == " ")
+                continue;
+
+            std::vector<std::string> tokens = tokenize(line);
+            parseTokens(tokens, label, opcode, operands);
+            result.tokens += tokens.size();
+            if (timed)
+                result.lexMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - lexStart).count();
+        }
+
+        // A troca de seção vem antes do rótulo: "L: SECTION DATA" marca o início dos dados
+        if (opcode == "SECTION")
+        {
+            if (operands.size() != 1 || !sectionNamed(operands[0], result.section))
+                throw std::runtime_error("Error: Invalid section: " + line);
+            TRACE(log, "Switching to section " << operands[0] << std::endl);
+        }
+        std::vector<int> &words = result.words[result.section];
+        int locationCounter = static_cast<int>(words.size());
+
+        // Printar a tabela de símbolos (somente com rastreamento ativo)
+        if (MONTADOR_TRACE && log)
+        {
+            log << "\n\n Symbol Table:" << std::endl;
+            for (const auto &symbol : result.symbols)
+            {
+                log << "Label: " << symbol.name << ", Address: " << symbol.info.address << ", Extern: " << symbol.info.isExtern << std::endl;
+            }
+        }
+
+        // Processar rótulo
+        if (!label.empty())
+        {
+            if (!isValidLabel(label))
+                throw std::runtime_error("Error: Invalid label: " + label);
+
+            TRACE(log, "Processing label: " << label << std::endl);
+
+            if (opcode == "BEGIN")
+            {
+                TRACE(log, "Found BEGIN directive." << std::endl);
+                result.hasBegin = true;
+                define(label, {locationCounter, false, true}, lineIndex);
+                result.definitions.push_back(label);
+                continue;
+            }
+            else if (opcode == "EXTERN")
+            {
+                TRACE(log, "Found EXTERN directive." << std::endl);
+                define(label, {0, true, false}, lineIndex); // Endereço 0 e externo
+                continue;                                  // Não processa como instrução
+            }
+
+            define(label, {locationCounter, false, true}, lineIndex); // Endereço atual e não externo
+            if (opcode == "CONST")
+                result.definitions.push_back(label);
+        }
+
+        // Processar diretiva ou instrução (com ou sem rótulo)
+        if (opcode.empty())
+        {
+            continue; // Rótulo sozinho na linha
+        }
+        else if (opcode == "SECTION")
+        {
+            continue;
+        }
+        else if (opcode == "END")
+        {
+            TRACE(log, "Found END directive." << std::endl);
+            result.hasEnd = true;
+        }
+        else if (opcode == "PUBLIC")
+        {
+            TRACE(log, "Found PUBLIC directive." << std::endl);
+            for (const auto &operand : operands)
+            {
+                result.definitions.push_back(operand);
+            }
+        }
+        else if (opcode == "SPACE")
+        {
+            TRACE(log, "Processing SPACE directive." << std::endl);
+            int spaceSize = 1; // SPACE sem operando reserva uma palavra
+            if (!operands.empty())
+            {
+                if (!isValidImmediateValue(operands[0]) || !Lexer::parseDecimal(operands[0], spaceSize))
+                    throw std::runtime_error("Error: Invalid operand for SPACE directive: " + operands[0]);
+            }
+            words.insert(words.end(), spaceSize, 0);
+        }
+        else if (opcode == "CONST")
+        {
+            TRACE(log, "Processing CONST directive." << std::endl);
+            if (operands.empty())
+                throw std::runtime_error("Error: Missing operand for CONST directive.");
+            int value = 0;
+            if (!Lexer::parseDecimal(operands[0], value))
+                throw std::runtime_error("Error: Invalid operand for CONST directive: " + operands[0]);
+            words.push_back(value);
+        }
+        else
+        {
+            TRACE(log, "Processing instruction: " << opcode << " in location counter: " << locationCounter << std::endl);
+            words.push_back(getOpcodeValue(opcode));
+
+            // Operandos separados por vírgula; cada um é imediato, SIMBOLO ou SIMBOLO op N
+            size_t start = label.empty() ? 0 : line.find(':') + 1;
+            start = line.find(opcode, start) + opcode.size();
+            std::vector<std::string> operandTexts;
+            std::istringstream rest(line.substr(start));
+            std::string operandText;
+            while (std::getline(rest, operandText, ','))
+                operandTexts.push_back(operandText);
+            if (operandTexts.size() == 1 && operandTexts[0].find_first_not_of(' ') == std::string::npos)
+                operandTexts.clear();
+            if (!hasCorrectNumberOfOperands(opcode, operandTexts.size()))
+                throw std::runtime_error("Error: Wrong number of operands for " + opcode + ": " + line);
+
+            for (const auto &text : operandTexts)
+            {
+                Reference reference{static_cast<int>(words.size()), "", 0, 0, lineIndex, result.section};
+                if (!parseOperand(text, reference))
+                    throw std::runtime_error("Error: Invalid expression: " + line);
+                if (reference.symbol.empty())
+                {
+                    TRACE(log, "Processing immediate value: " << reference.value << std::endl);
+                    words.push_back(reference.value);
+                }
+                else
+                {
+                    TRACE(log, "Adding pending reference for operand: " << text << " in location counter: " << words.size() << std::endl);
+                    result.references.push_back(reference);
+                    words.push_back(0);
+                }
+            }
+        }
+    }
+}
+
+// Operando "N", "SIMBOLO" ou "SIMBOLO op N"; um operando sem símbolo fica com reference.symbol vazio
+bool Assembler::parseOperand(const std::string &text, Reference &reference)
+{
+    OperandText operand;
+    if (!Lexer::splitOperand(text, operand))
+        return false;
+    reference.symbol = std::string(operand.symbol);
+    reference.op = operand.op;
+    return operand.number.empty() || Lexer::parseDecimal(operand.number, reference.value);
+}
+
+// Seção em vigor depois das linhas [begin, end), partindo de section; só olha as diretivas SECTION
+Section Assembler::sectionAt(const std::vector<std::string> &lines, size_t begin, size_t end, Section section)
+{
+    for (size_t i = begin; i < end; ++i)
+    {
+        if (lines[i].find("SECTION") == std::string::npos)
+            continue;
+        std::string label, opcode;
+        std::vector<std::string> operands;
+        parseTokens(tokenize(removeComments(lines[i])), label, opcode, operands);
+        if (opcode == "SECTION" && operands.size() == 1)
+            sectionNamed(operands[0], section);
+    }
+    return section;
+}
+
+// Segunda passagem de um trecho: substitui as referências pendentes usando a tabela global
+void Assembler::secondPass(FirstPassResult &chunk, const SectionBases &bases, const std::unordered_map<std::string, SymbolInfo> &symbolTable, std::ostream &log)
+{
+    for (int section = 0; section < SectionCount; ++section)
+        chunk.relocation[section].assign(chunk.words[section].size(), '0');
+    for (const auto &reference : chunk.references)
+    {
+        int base = bases[reference.section];
+        auto it = symbolTable.find(reference.symbol);
+        if (it == symbolTable.end())
+        {
+            TRACE(log, "Unresolved reference at position " << base + reference.position << ". Using default value 00." << std::endl);
+            chunk.diagnostics.push_back({reference.line + 1, "Warning: Unresolved reference to symbol: " + reference.symbol, false});
+            continue;
+        }
+
+        // Um símbolo externo só admite deslocamento: a palavra guarda a parcela e o ligador soma o endereço
+        if (it->second.isExtern && !Lexer::isRelocatable(reference.op))
+        {
+            chunk.diagnostics.push_back({reference.line + 1, "Error: Invalid operator for external symbol: " + reference.symbol, true});
+            continue;
+        }
+
+        int value = 0;
+        if (!Lexer::applyOperator(it->second.address, reference.op, reference.value, value))
+        {
+            if (reference.op == '/')
+                chunk.diagnostics.push_back({reference.line + 1, "Error: Invalid division: " + std::to_string(it->second.address) + " / " + std::to_string(reference.value), true});
+            else
+                chunk.diagnostics.push_back({reference.line + 1, "Error: Invalid operator: " + std::string(1, reference.op), true});
+            continue;
+        }
+
+        chunk.words[reference.section][reference.position] = value;
+        if (it->second.isExtern)
+            chunk.usages.push_back({reference.symbol, base + reference.position});
+        else if (Lexer::isRelocatable(reference.op))
+            chunk.relocation[reference.section][reference.position] = '1'; // Endereço relativo ao início do módulo
+        TRACE(log, "Resolved reference for symbol: " << reference.symbol << " at position " << base + reference.position << " with value " << value << std::endl);
+    }
+}
+
+bool ObjectCode::ok() const
+{
+    for (const auto &diagnostic : diagnostics)
+    {
+        if (diagnostic.isError)
+            return false;
+    }
+    return true;
+}
+
+ObjectCode Assembler::assembleObject(std::string_view source)
+{
+    std::vector<std::string> lines;
+    size_t start = 0;
+    while (start < source.size())
+    {
+        size_t end = source.find('\n', start);
+        if (end == std::string_view::npos)
+            end = source.size();
+        std::string_view line = source.substr(start, end - start);
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        lines.emplace_back(line);
+        start = end + 1;
+    }
+    return assembleObject(lines);
+}
+
+// Monta um programa inteiramente em memória; erros e avisos vão para object.diagnostics
+ObjectCode Assembler::assembleObject(const std::vector<std::string> &sourceLines)
+{
+    std::ostream silent(nullptr);
+    std::ostream &log = trace ? *trace : silent;
+    ObjectCode object;
+    const std::vector<std::string> *lines = &sourceLines;
+    std::vector<std::string> optimizedLines;
+
+    // Otimização opcional sobre as instruções já analisadas, antes de atribuir endereços
+    optimizerStats = {};
+    if (optimize)
+    {
+        for (const auto &rawLine : sourceLines)
+        {
+            std::string cleanLine = removeExtraSpaces(removeComments(rawLine));
+            if (!cleanLine.empty())
+                optimizedLines.push_back(cleanLine);
+        }
+        Optimizer optimizer;
+        optimizedLines = optimizer.optimize(optimizedLines);
+        optimizerStats = optimizer.getStats();
+        object.optimizerStats = optimizerStats;
+        lines = &optimizedLines;
+    }
+
+    // Divide a entrada em trechos de linhas inteiras; cada trecho faz a primeira passagem
+    // com contador de posição local, e um único trecho equivale à montagem serial
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threads, lines->size() / minimumChunkLines));
+    std::vector<FirstPassResult> chunks(chunkCount);
+    std::vector<std::string> chunkError(chunkCount);
+
+    // Cada trecho começa na seção deixada pelas diretivas SECTION dos trechos anteriores
+    for (size_t i = 1; i < chunkCount; ++i)
+        chunks[i].section = sectionAt(*lines, lines->size() * (i - 1) / chunkCount, lines->size() * i / chunkCount, chunks[i - 1].section);
+
+    auto runChunk = [&](size_t index)
+    {
+        size_t begin = lines->size() * index / chunkCount;
+        size_t end = lines->size() * (index + 1) / chunkCount;
+        PhaseScope phase("pass1"); // Os trechos rodam em outras threads
+        try
+        {
+            firstPass(*lines, begin, end, chunks[index], chunkCount == 1 ? log : silent);
+        }
+        catch (const std::exception &e)
+        {
+            chunkError[index] = e.what();
+        }
+    };
+
+    TRACE(log, "First pass:" << std::endl);
+    {
+        ScopedTimer timer("pass1");
+        runParallel(chunkCount, runChunk);
+    }
+
+    // Disposição final: o TEXT de todos os trechos, depois o DATA de todos. A soma de prefixos
+    // dos tamanhos de cada seção dá a base de cada trecho nela; símbolos são rebaseados e unidos
+    std::vector<SectionBases> bases(chunkCount);
+    int next = 0;
+    for (int section = 0; section < SectionCount; ++section)
+    {
+        for (size_t i = 0; i < chunkCount; ++i)
+        {
+            bases[i][section] = next;
+            next += static_cast<int>(chunks[i].words[section].size());
+        }
+        if (section == TextSection)
+            object.textSize = next;
+    }
+
+    std::unordered_map<std::string, SymbolInfo> symbolTable;
+    size_t errorLine = lines->size();
+    std::string error;
+    bool hasBegin = false;
+    bool hasEnd = false;
+    for (size_t i = 0; i < chunkCount; ++i)
+    {
+        if (!chunkError[i].empty() && chunks[i].line < errorLine)
+        {
+            errorLine = chunks[i].line;
+            error = chunkError[i];
+        }
+        for (const auto &definition : chunks[i].symbols)
+        {
+            SymbolInfo info = definition.info;
+            if (!info.isExtern)
+                info.address += bases[i][definition.section];
+            // O rótulo é processado antes do resto da linha: na mesma linha, a redefinição vem primeiro
+            if (!symbolTable.emplace(definition.name, info).second && definition.line <= errorLine)
+            {
+                errorLine = definition.line;
+                error = "Error: Redefinition of symbol: " + definition.name;
+            }
+        }
+        hasBegin = hasBegin || chunks[i].hasBegin;
+        hasEnd = hasEnd || chunks[i].hasEnd;
+    }
+
+    // O tempo de análise léxica está dentro do da primeira passagem; somado entre os trechos
+    if (Stats::enabled())
+    {
+        double lexMilliseconds = 0;
+        long tokens = 0, references = 0;
+        for (const auto &chunk : chunks)
+        {
+            lexMilliseconds += chunk.lexMilliseconds;
+            tokens += static_cast<long>(chunk.tokens);
+            references += static_cast<long>(chunk.references.size());
+        }
+        Stats::addTime("lex", lexMilliseconds);
+        Stats::count("lines", static_cast<long>(lines->size()));
+        Stats::count("tokens", tokens);
+        Stats::count("symbols", static_cast<long>(symbolTable.size()));
+        Stats::count("references", references);
+        Stats::count("words", next);
+    }
+    if (!error.empty())
+    {
+        object.diagnostics.push_back({errorLine + 1, error, true});
+        return object;
+    }
+
+    if ((hasBegin && !hasEnd) || (!hasBegin && hasEnd))
+    {
+        object.diagnostics.push_back({0, "Error: Missing BEGIN or END directive.", true});
+        return object;
+    }
+
+    // Segunda Passagem: cada trecho corrige suas próprias palavras
+    TRACE(log, "Second pass: Resolving pending references." << std::endl);
+    {
+        ScopedTimer timer("pass2");
+        runParallel(chunkCount, [&](size_t index)
+                    {
+                        PhaseScope phase("pass2");
+                        secondPass(chunks[index], bases[index], symbolTable, chunkCount == 1 ? log : silent); });
+
+        for (const auto &chunk : chunks)
+            object.diagnostics.insert(object.diagnostics.end(), chunk.diagnostics.begin(), chunk.diagnostics.end());
+        object.code.reserve(next);
+        for (int section = 0; section < SectionCount; ++section)
+        {
+            for (const auto &chunk : chunks)
+            {
+                object.code.insert(object.code.end(), chunk.words[section].begin(), chunk.words[section].end());
+                object.relocation += chunk.relocation[section];
+            }
+        }
+    }
+    if (!object.ok())
+        return object;
+
+    // Tabela de definições: BEGIN, CONST e PUBLIC com seus endereços finais
+    std::unordered_set<std::string> defined;
+    for (const auto &chunk : chunks)
+    {
+        for (const auto &symbol : chunk.definitions)
+        {
+            if (!defined.insert(symbol).second)
+                continue;
+            auto it = symbolTable.find(symbol);
+            if (it == symbolTable.end() || it->second.isExtern)
+            {
+                object.diagnostics.push_back({0, "Error: Undefined public symbol: " + symbol, true});
+                return object;
+            }
+            TRACE(log, "Definition: " << symbol << " " << it->second.address << std::endl);
+            object.definitions.push_back({symbol, it->second.address});
+        }
+    }
+
+    // Tabela de uso agrupada por símbolo, na ordem do primeiro uso
+    std::unordered_map<std::string, size_t> usageIndex;
+    for (const auto &chunk : chunks)
+    {
+        for (const auto &[symbol, position] : chunk.usages)
+        {
+            auto it = usageIndex.find(symbol);
+            if (it == usageIndex.end())
+            {
+                it = usageIndex.emplace(symbol, object.usages.size()).first;
+                object.usages.push_back({symbol, {}});
+            }
+            TRACE(log, "Usage: " << symbol << " " << position << std::endl);
+            object.usages[it->second].second.push_back(position);
+        }
+    }
+    return object;
+}
+
+void Assembler::assemble(std::istream &input, std::ostream &finalOutput)
+{
+    std::string line;
+    std::vector<std::string> lines;
+    {
+        ScopedTimer timer("read");
+        while (std::getline(input, line))
+        {
+            lines.push_back(line);
+        }
+    }
+
+    ObjectCode object = assembleObject(lines);
+    for (const auto &diagnostic : object.diagnostics)
+    {
+        if (diagnostic.isError)
+            throw std::runtime_error(diagnostic.message);
+    }
+    ScopedTimer timer("emit");
+    writeObject(object, finalOutput);
+}
+
+void Assembler::writeObject(const ObjectCode &object, std::ostream &output)
+{
+    for (int word : object.code)
+    {
+        if (word == 0)
+            output << "00 ";
+        else
+            output << word << " ";
+    }
+    output << std::endl;
+    output << "REAL " << object.relocation << std::endl;
+    // Só objetos com DATA levam os tamanhos das seções; sem eles, tudo é TEXT
+    if (object.textSize < object.code.size())
+        output << "SECTIONS " << object.textSize << " " << object.code.size() - object.textSize << std::endl;
+
+    output << "DEFINITION TABLE:" << std::endl;
+    for (const auto &[symbol, address] : object.definitions)
+    {
+        output << symbol << " " << address << std::endl;
+    }
+
+    output << "USAGE TABLE:" << std::endl;
+    for (const auto &[symbol, refs] : object.usages)
+    {
+        output << symbol << " ";
+        for (const auto &ref : refs)
+        {
+            output << ref << " ";
+        }
+        output << std::endl;
+    }
+}
+
+// Executa task(0..count-1), em threads separadas quando há mais de um trecho
+void Assembler::runParallel(size_t count, const std::function<void(size_t)> &task)
+{
+    if (count == 1)
+    {
+        task(0);
+        return;
+    }
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < count; ++i)
+        workers.emplace_back(task, i);
+    for (auto &worker : workers)
+        worker.join();
+}
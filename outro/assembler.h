@@ -1,23 +1,129 @@
-#ifndef ASSEMBLER_H
-#define ASSEMBLER_H
-
-#include <string>
-#include <vector>
-#include <unordered_map>
-
-class Assembler {
-public:
-    void assemble(const std::string &inputFile, const std::string &outputFile);
-    std::string removeComments(const std::string &line);
-    std::string removeExtraSpaces(const std::string &line);
-    std::vector<std::string> tokenize(const std::string &line);
-    void parseTokens(const std::vector<std::string> &tokens, std::string &objCode, std::string &label, std::vector<std::string> &operand);
-    bool isValidLabel(const std::string &label);
-    bool isValidOpcode(const std::string &opcode);
-    bool isValidDirective(const std::string &directive);
-    bool hasCorrectNumberOfOperands(const std::string &opcode, size_t operandCount);
-    int getOpcodeValue(const std::string &opcode);
-    bool isValidImmediateValue(const std::string &value);
-};
-
-#endif // ASSEMBLER_H
+#ifndef ASSEMBLER_H
+#define ASSEMBLER_H
+
+#include <array>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <istream>
+#include <ostream>
+#include <functional>
+#include <string_view>
+#include "optimizer.h"
+
+// Seções de um módulo; na imagem final todo o TEXT vem antes de todo o DATA
+enum Section
+{
+    TextSection,
+    DataSection,
+    SectionCount
+};
+
+using SectionBases = std::array<int, SectionCount>;
+
+struct SymbolInfo
+{
+    int address;
+    bool isExtern;
+    bool isResolved;
+};
+
+struct SymbolDefinition
+{
+    std::string name;
+    SymbolInfo info;
+    size_t line; // Linha da definição, para reportar o primeiro erro
+    Section section;
+};
+
+// Palavra que depende de um símbolo: SIMBOLO, ou SIMBOLO op valor
+struct Reference
+{
+    int position;
+    std::string symbol;
+    char op;
+    int value;
+    size_t line;
+    Section section; // Buffer em que está a palavra
+};
+
+struct Diagnostic
+{
+    size_t line; // 1 em diante; 0 quando não se refere a uma linha
+    std::string message;
+    bool isError;
+};
+
+// Resultado da primeira passagem de um trecho de linhas, com endereços locais ao trecho
+// e a cada seção: cada seção tem seu próprio buffer e contador de posição
+struct FirstPassResult
+{
+    std::vector<int> words[SectionCount];
+    std::vector<SymbolDefinition> symbols;
+    std::vector<Reference> references;
+    std::vector<std::string> definitions; // BEGIN, CONST e PUBLIC, na ordem do fonte
+    std::vector<std::pair<std::string, int>> usages;
+    std::string relocation[SectionCount];
+    std::vector<Diagnostic> diagnostics;
+    Section section = TextSection; // Seção corrente; na entrada, a que vale no início do trecho
+    size_t line = 0; // Linha em processamento (a do erro, se a passagem falhar)
+    size_t tokens = 0;
+    double lexMilliseconds = 0; // Só medido com a instrumentação ligada
+    bool hasBegin = false;
+    bool hasEnd = false;
+};
+
+// Objeto montado em memória
+struct ObjectCode
+{
+    std::vector<int> code;
+    std::string relocation; // '1' nas palavras com endereço relativo ao módulo
+    size_t textSize = 0;    // Palavras da seção TEXT; as seguintes são DATA
+    std::vector<std::pair<std::string, int>> definitions;
+    std::vector<std::pair<std::string, std::vector<int>>> usages;
+    std::vector<Diagnostic> diagnostics;
+    OptimizerStats optimizerStats;
+
+    bool ok() const;
+};
+
+class Assembler {
+public:
+    void assemble(const std::string &inputFile, const std::string &outputFile);
+    void assemble(std::istream &input, std::ostream &output);
+    ObjectCode assembleObject(std::string_view source);
+    ObjectCode assembleObject(const std::vector<std::string> &lines);
+    static void writeObject(const ObjectCode &object, std::ostream &output);
+    void setOptimize(bool enabled);
+    void setTrace(std::ostream &stream);
+    void setThreads(unsigned count);
+    void setMinimumChunkLines(size_t lines);
+    const OptimizerStats &getOptimizerStats() const;
+    std::string removeComments(const std::string &line);
+    std::string removeExtraSpaces(const std::string &line);
+    std::vector<std::string> tokenize(const std::string &line);
+    void parseTokens(const std::vector<std::string> &tokens, std::string &objCode, std::string &label, std::vector<std::string> &operand);
+    bool isValidLabel(const std::string &label);
+    bool isValidOpcode(const std::string &opcode);
+    bool isValidDirective(const std::string &directive);
+    bool hasCorrectNumberOfOperands(const std::string &opcode, size_t operandCount);
+    int getOpcodeValue(const std::string &opcode);
+    bool isValidImmediateValue(const std::string &value);
+
+private:
+    friend class IncrementalAssembler;
+
+    void firstPass(const std::vector<std::string> &lines, size_t begin, size_t end, FirstPassResult &result, std::ostream &log);
+    void secondPass(FirstPassResult &chunk, const SectionBases &bases, const std::unordered_map<std::string, SymbolInfo> &symbolTable, std::ostream &log);
+    static void runParallel(size_t count, const std::function<void(size_t)> &task);
+    bool parseOperand(const std::string &text, Reference &reference);
+    Section sectionAt(const std::vector<std::string> &lines, size_t begin, size_t end, Section section);
+
+    bool optimize = false;
+    unsigned threads = 1;
+    size_t minimumChunkLines = 4096; // Trechos menores não compensam criar uma thread
+    OptimizerStats optimizerStats;
+    std::ostream *trace = nullptr;
+};
+
+#endif // ASSEMBLER_H
@@ -0,0 +1,140 @@
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "assembler.h"
+#include "cfg.h"
+#include "generator.h"
+#include "linker.h"
+#include "preprocessor.h"
+#include "simulator.h"
+
+namespace
+{
+    double minimumSeconds = 0.5;
+
+    // Repete o corpo até somar o tempo mínimo (ao menos uma vez), como o Google Benchmark;
+    // words é lido depois das repetições, então o próprio corpo pode calculá-lo
+    void run(const std::string &name, size_t lines, const size_t &words, const std::function<void()> &body)
+    {
+        long iterations = 0;
+        double seconds = 0;
+        while (iterations == 0 || seconds < minimumSeconds)
+        {
+            auto start = std::chrono::steady_clock::now();
+            body();
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            ++iterations;
+        }
+        double perIteration = seconds / iterations;
+        std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(12) << perIteration * 1000 << " ms" << std::setw(10) << iterations
+                  << std::setprecision(0) << std::setw(16) << lines / perIteration << " lines/s";
+        if (words > 0)
+            std::cout << std::setw(16) << words / perIteration << " words/s";
+        std::cout << std::endl;
+    }
+}
+
+// Mede pré-processamento, montagem, ligação, análises de fluxo e simulação separadamente sobre programas
+// sintéticos de 1K linhas até --max linhas, multiplicando por 10
+int main(int argc, char *argv[])
+{
+    GeneratorOptions options;
+    size_t maximumLines = 1000000;
+    try
+    {
+        for (int i = 1; i + 1 < argc; i += 2)
+        {
+            std::string arg = argv[i];
+            std::string value = argv[i + 1];
+            if (arg == "--max")
+                maximumLines = std::stoul(value);
+            else if (arg == "--min-time")
+                minimumSeconds = std::stod(value);
+            else if (arg == "--modules")
+                options.modules = std::stoul(value);
+            else if (arg == "--seed")
+                options.seed = std::stoul(value);
+            else
+                throw std::runtime_error("Unknown option: " + arg);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        std::cerr << "Usage: " << argv[0] << " [--max lines] [--min-time seconds] [--modules n] [--seed s]" << std::endl;
+        return 1;
+    }
+
+    std::cout << std::left << std::setw(28) << "Benchmark" << std::right << std::setw(15) << "Time"
+              << std::setw(10) << "Iter" << std::setw(24) << "Lines" << std::setw(24) << "Words" << std::endl;
+    try
+    {
+        for (size_t lines = 1000; lines <= maximumLines; lines *= 10)
+        {
+            options.lines = lines;
+            std::vector<std::string> sources = ProgramGenerator(options).generate();
+            std::string size = "/" + std::to_string(lines);
+
+            std::vector<std::string> preprocessed(sources.size());
+            size_t words = 0;
+            run("BM_Preprocess" + size, lines, words, [&]()
+                {
+                    for (size_t i = 0; i < sources.size(); ++i)
+                    {
+                        std::istringstream input(sources[i]);
+                        std::ostringstream output;
+                        Preprocessor().preprocess(input, output);
+                        preprocessed[i] = output.str();
+                    } });
+
+            std::vector<ObjectCode> objects(sources.size());
+            run("BM_Assemble" + size, lines, words, [&]()
+                {
+                    words = 0;
+                    for (size_t i = 0; i < sources.size(); ++i)
+                    {
+                        objects[i] = Assembler().assembleObject(preprocessed[i]);
+                        words += objects[i].code.size();
+                    } });
+            std::vector<Module> modules;
+            for (size_t i = 0; i < objects.size(); ++i)
+            {
+                if (!objects[i].ok())
+                    throw std::runtime_error("Generated module " + std::to_string(i) + " did not assemble: " + objects[i].diagnostics.front().message);
+                std::stringstream object;
+                Assembler::writeObject(objects[i], object);
+                modules.push_back(Linker::readModule(object, "module" + std::to_string(i)));
+            }
+
+            std::vector<int> image;
+            run("BM_Link" + size, lines, words, [&]()
+                { image = Linker().link(modules); });
+
+            // Análises de fluxo sobre a imagem ligada; devem crescer linearmente com ela
+            ControlFlowGraph graph(image);
+            BlockSets liveIn, liveOut;
+            run("BM_Liveness" + size, lines, words, [&]()
+                { graph.liveness(liveIn, liveOut); });
+            run("BM_ReachingDefinitions" + size, lines, words, [&]()
+                { graph.reachingDefinitions(); });
+
+            run("BM_Simulate" + size, lines, words, [&]()
+                {
+                    std::istringstream input;
+                    std::ostream output(nullptr);
+                    Simulator(image).run(input, output); });
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,237 @@
+#include "cache.h"
+#include "sha256.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <system_error>
+#include <thread>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    const std::uint64_t flushInterval = 256; // Eventos de acerto/falta por atualização do registro
+
+    struct CacheRecord
+    {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        std::uint64_t bytes = 0;
+    };
+
+    // false se não existe ou não tem o tamanho do registro (por exemplo, o antigo log de eventos)
+    bool readRecord(const fs::path &path, CacheRecord &record)
+    {
+        std::ifstream input(path, std::ios::binary);
+        input.read(reinterpret_cast<char *>(&record), sizeof(record));
+        return input.gcount() == sizeof(record) && input.peek() == std::char_traits<char>::eof();
+    }
+}
+
+// Faz parte da chave: mudar a saída do montador/ligador exige mudar a versão
+const char *const BuildCache::toolVersion = "montador-3";
+
+BuildCache::BuildCache(const std::string &directory, std::uintmax_t maximumBytes)
+    : directory(directory), maximumBytes(maximumBytes)
+{
+    fs::create_directories(fs::path(directory) / "objects");
+    CacheRecord record;
+    if (readRecord(fs::path(directory) / "stats", record))
+        knownBytes = record.bytes;
+}
+
+BuildCache::~BuildCache()
+{
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    if (pendingHits + pendingMisses + pendingBytes > 0)
+        flush();
+}
+
+// MONTADOR_CACHE=diretório ativa o cache; MONTADOR_CACHE_SIZE=megabytes (padrão 256)
+std::unique_ptr<BuildCache> BuildCache::fromEnvironment()
+{
+    const char *directory = std::getenv("MONTADOR_CACHE");
+    if (directory == nullptr || *directory == '\0')
+        return nullptr;
+    std::uintmax_t megabytes = 256;
+    if (const char *size = std::getenv("MONTADOR_CACHE_SIZE"))
+        megabytes = std::strtoull(size, nullptr, 10);
+    return std::make_unique<BuildCache>(directory, megabytes * 1024 * 1024);
+}
+
+std::string BuildCache::key(const std::string &tool, const std::string &options, const std::vector<std::string> &inputs)
+{
+    std::string material = std::string(toolVersion) + '\0' + tool + '\0' + options;
+    for (const auto &input : inputs)
+        material += '\0' + std::to_string(input.size()) + '\0' + input;
+    return Sha256::hex(material);
+}
+
+bool BuildCache::lookup(const std::string &key, std::string &artifact)
+{
+    fs::path path = fs::path(directory) / "objects" / key;
+    std::ifstream input(path, std::ios::binary);
+    if (!input)
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        if (++pendingMisses + pendingHits >= flushInterval)
+            flush();
+        return false;
+    }
+    std::stringstream content;
+    content << input.rdbuf();
+    artifact = content.str();
+
+    // A data de modificação marca o último uso para o descarte LRU
+    std::error_code error;
+    fs::last_write_time(path, fs::file_time_type::clock::now(), error);
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    if (++pendingHits + pendingMisses >= flushInterval)
+        flush();
+    return true;
+}
+
+// Grava em arquivo temporário e renomeia: leitores nunca veem um artefato incompleto
+void BuildCache::store(const std::string &key, const std::string &artifact)
+{
+    std::random_device random;
+    fs::path objects = fs::path(directory) / "objects";
+    fs::path temporary = objects / (".tmp." + std::to_string(::getpid()) + "." + std::to_string(random()));
+    {
+        std::ofstream output(temporary, std::ios::binary);
+        if (!output)
+            return;
+        output << artifact;
+        if (!output)
+        {
+            std::error_code error;
+            fs::remove(temporary, error);
+            return;
+        }
+    }
+    std::error_code error;
+    fs::rename(temporary, objects / key, error);
+    if (error)
+    {
+        fs::remove(temporary, error);
+        return;
+    }
+
+    // O diretório só é varrido quando a estimativa passa do limite
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    pendingBytes += artifact.size();
+    if (knownBytes + pendingBytes > maximumBytes)
+        flush();
+}
+
+// Soma os eventos pendentes ao registro sob flock e o regrava por temporário + rename. Sem
+// registro válido, ou com a estimativa acima do limite, varre o diretório (evict) e corrige
+void BuildCache::flush()
+{
+    fs::path stats = fs::path(directory) / "stats";
+    std::string lockPath = (fs::path(directory) / "stats.lock").string();
+    int lockFd = ::open(lockPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (lockFd < 0)
+        return;
+    ::flock(lockFd, LOCK_EX);
+
+    CacheRecord record;
+    bool valid = readRecord(stats, record);
+    if (!valid)
+        record = {};
+    record.hits += pendingHits;
+    record.misses += pendingMisses;
+    record.bytes += pendingBytes;
+    if (!valid || record.bytes > maximumBytes)
+        record.bytes = evict();
+
+    std::random_device random;
+    fs::path temporary = fs::path(directory) / (".stats." + std::to_string(::getpid()) + "." + std::to_string(random()));
+    {
+        std::ofstream output(temporary, std::ios::binary);
+        output.write(reinterpret_cast<const char *>(&record), sizeof(record));
+    }
+    std::error_code error;
+    fs::rename(temporary, stats, error);
+    if (error)
+        fs::remove(temporary, error);
+    else
+    {
+        pendingHits = pendingMisses = pendingBytes = 0;
+        knownBytes = record.bytes;
+    }
+    ::flock(lockFd, LOCK_UN);
+    ::close(lockFd);
+}
+
+// Remove os artefatos usados há mais tempo até caber no limite; devolve o tamanho que sobra
+std::uintmax_t BuildCache::evict()
+{
+    struct Entry
+    {
+        fs::path path;
+        fs::file_time_type lastUse;
+        std::uintmax_t size;
+    };
+    std::vector<Entry> entries;
+    std::uintmax_t total = 0;
+    std::error_code error;
+    for (const auto &entry : fs::directory_iterator(fs::path(directory) / "objects", error))
+    {
+        std::string name = entry.path().filename().string();
+        if (name.rfind(".tmp.", 0) == 0)
+            continue;
+        std::error_code entryError;
+        Entry item{entry.path(), fs::last_write_time(entry.path(), entryError), fs::file_size(entry.path(), entryError)};
+        if (entryError)
+            continue; // Removido por outro processo
+        total += item.size;
+        entries.push_back(item);
+    }
+    if (total <= maximumBytes)
+        return total;
+
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b)
+              { return a.lastUse < b.lastUse; });
+    for (const auto &entry : entries)
+    {
+        if (total <= maximumBytes)
+            break;
+        if (fs::remove(entry.path, error))
+            total -= entry.size;
+    }
+    return total;
+}
+
+void BuildCache::printStatistics(std::ostream &output) const
+{
+    CacheRecord record;
+    if (!readRecord(fs::path(directory) / "stats", record))
+        record = {};
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    std::uint64_t hits = record.hits + pendingHits;
+    std::uint64_t misses = record.misses + pendingMisses;
+
+    std::uintmax_t bytes = 0;
+    long entries = 0;
+    std::error_code error;
+    for (const auto &entry : fs::directory_iterator(fs::path(directory) / "objects", error))
+    {
+        if (entry.path().filename().string().rfind(".tmp.", 0) == 0)
+            continue;
+        bytes += fs::file_size(entry.path(), error);
+        entries++;
+    }
+
+    output << "Cache " << directory << ": " << hits << " hits, " << misses << " misses";
+    if (hits + misses > 0)
+        output << " (" << 100 * hits / (hits + misses) << "% hit rate)";
+    output << ", " << entries << " entries, " << bytes << " of " << maximumBytes << " bytes" << std::endl;
+}
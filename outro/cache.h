@@ -0,0 +1,43 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Cache local de artefatos (.pre, .obj, .e) endereçado pelo conteúdo das entradas.
+// <diretório>/stats é um registro de tamanho fixo (acertos, faltas e bytes estimados) que os
+// processos atualizam sob flock, em lotes: os eventos ficam em memória até flushInterval, até
+// a estimativa passar do limite ou até o destrutor
+class BuildCache
+{
+public:
+    BuildCache(const std::string &directory, std::uintmax_t maximumBytes);
+    ~BuildCache();
+    static std::unique_ptr<BuildCache> fromEnvironment();
+    static std::string key(const std::string &tool, const std::string &options, const std::vector<std::string> &inputs);
+
+    bool lookup(const std::string &key, std::string &artifact);
+    void store(const std::string &key, const std::string &artifact);
+    void printStatistics(std::ostream &output) const;
+
+    static const char *const toolVersion;
+
+private:
+    void flush(); // Com pendingMutex travado
+    std::uintmax_t evict();
+
+    std::string directory;
+    std::uintmax_t maximumBytes;
+
+    mutable std::mutex pendingMutex;
+    std::uint64_t pendingHits = 0;
+    std::uint64_t pendingMisses = 0;
+    std::uint64_t pendingBytes = 0; // Gravados desde o último flush
+    std::uint64_t knownBytes = 0;   // Tamanho do cache no último registro lido
+};
+
+#endif // CACHE_H
@@ -0,0 +1,402 @@
+#include "cfg.h"
+#include "isa.h"
+#include <algorithm>
+#include <utility>
+
+namespace
+{
+    void setBit(uint64_t *row, size_t index)
+    {
+        row[index / 64] |= uint64_t(1) << (index % 64);
+    }
+
+    void clearBit(uint64_t *row, size_t index)
+    {
+        row[index / 64] &= ~(uint64_t(1) << (index % 64));
+    }
+
+    void insertSorted(std::vector<int> &set, int value)
+    {
+        auto it = std::lower_bound(set.begin(), set.end(), value);
+        if (it == set.end() || *it != value)
+            set.insert(it, value);
+    }
+
+    bool containsSorted(const std::vector<int> &set, int value)
+    {
+        return std::binary_search(set.begin(), set.end(), value);
+    }
+}
+
+// Descobre o código por travessia a partir dos pontos de entrada: cada palavra é decodificada
+// uma única vez, e o que não é alcançado (SPACE/CONST) fica marcado como dado
+ControlFlowGraph::ControlFlowGraph(const std::vector<int> &code, const std::vector<int> &entryPoints,
+                                   const std::vector<int> &externalReferences)
+    : code(code), codeWord(code.size(), 0), instructionStart(code.size(), 0), external(code.size(), 0), blockOf(code.size(), -1)
+{
+    int size = static_cast<int>(code.size());
+    for (int position : externalReferences)
+    {
+        if (position >= 0 && position < size)
+            external[position] = 1;
+    }
+
+    std::vector<char> leader(code.size(), 0);
+    std::vector<int> worklist;
+    for (int entry : entryPoints)
+    {
+        if (entry >= 0 && entry < size)
+        {
+            leader[entry] = 1;
+            worklist.push_back(entry);
+        }
+    }
+
+    while (!worklist.empty())
+    {
+        int address = worklist.back();
+        worklist.pop_back();
+
+        while (address < size && !instructionStart[address])
+        {
+            int opcode = code[address];
+            int length = Isa::size(opcode);
+            if (length == 0 || address + length > size)
+                break; // Código inválido: trata como dado
+
+            instructionStart[address] = 1;
+            for (int i = 0; i < length; ++i)
+                codeWord[address + i] = 1;
+
+            if (Isa::isJump(opcode))
+            {
+                int target = operand(address, 0);
+                if (target >= 0)
+                {
+                    leader[target] = 1;
+                    worklist.push_back(target);
+                }
+            }
+            if ((Isa::isJump(opcode) || Isa::endsBlock(opcode)) && address + length < size)
+                leader[address + length] = 1;
+            if (Isa::endsBlock(opcode))
+                break;
+            address += length;
+        }
+    }
+
+    // Monta os blocos percorrendo as instruções em ordem de endereço
+    for (int address = 0; address < size; ++address)
+    {
+        if (!instructionStart[address])
+            continue;
+        if (blocks.empty() || leader[address] || blocks.back().end != address)
+        {
+            BasicBlock block;
+            block.start = block.end = address;
+            blocks.push_back(block);
+        }
+
+        BasicBlock &block = blocks.back();
+        int length = Isa::size(code[address]);
+        for (int i = 0; i < length; ++i)
+            blockOf[address + i] = static_cast<int>(blocks.size()) - 1;
+        block.end = address + length;
+        address += length - 1;
+    }
+
+    // Arestas a partir da última instrução de cada bloco
+    for (size_t index = 0; index < blocks.size(); ++index)
+    {
+        BasicBlock &block = blocks[index];
+        int last = block.start;
+        for (int address = block.start; address < block.end; address += Isa::size(code[address]))
+            last = address;
+
+        int opcode = code[last];
+        if (Isa::isJump(opcode))
+        {
+            int target = operand(last, 0);
+            if (target >= 0 && instructionStart[target])
+                block.successors.push_back(blockOf[target]);
+            else if (external[last + 1])
+                block.leavesModule = true;
+        }
+        if (!Isa::endsBlock(opcode) && block.end < size && instructionStart[block.end])
+        {
+            int next = blockOf[block.end];
+            if (std::find(block.successors.begin(), block.successors.end(), next) == block.successors.end())
+                block.successors.push_back(next);
+        }
+        for (int successor : block.successors)
+            blocks[successor].predecessors.push_back(static_cast<int>(index));
+    }
+}
+
+// Operando local da instrução em address, ou -1 se externo ou fora da imagem
+int ControlFlowGraph::operand(int address, int index) const
+{
+    int position = address + 1 + index;
+    if (position >= static_cast<int>(code.size()) || external[position])
+        return -1;
+    int value = code[position];
+    return value >= 0 && value < static_cast<int>(code.size()) ? value : -1;
+}
+
+const std::vector<BasicBlock> &ControlFlowGraph::getBlocks() const
+{
+    return blocks;
+}
+
+bool ControlFlowGraph::isCode(int address) const
+{
+    return address >= 0 && address < static_cast<int>(code.size()) && codeWord[address];
+}
+
+bool ControlFlowGraph::isInstructionStart(int address) const
+{
+    return address >= 0 && address < static_cast<int>(code.size()) && instructionStart[address];
+}
+
+int ControlFlowGraph::blockAt(int address) const
+{
+    if (address < 0 || address >= static_cast<int>(code.size()))
+        return -1;
+    return blockOf[address];
+}
+
+std::vector<int> ControlFlowGraph::getDataAddresses() const
+{
+    std::vector<int> data;
+    for (size_t address = 0; address < code.size(); ++address)
+    {
+        if (!codeWord[address])
+            data.push_back(static_cast<int>(address));
+    }
+    return data;
+}
+
+int ControlFlowGraph::writtenCell(int address) const
+{
+    int opcode = code[address];
+    if (!Isa::writesMemory(opcode))
+        return -1;
+    return operand(address, opcode == 9 ? 1 : 0);
+}
+
+// use: células lidas antes de qualquer escrita no bloco; def: células escritas no bloco
+void ControlFlowGraph::blockUseDef(const BasicBlock &block, std::vector<int> &use, std::vector<int> &def) const
+{
+    use.clear();
+    def.clear();
+    for (int address = block.start; address < block.end; address += Isa::size(code[address]))
+    {
+        int opcode = code[address];
+        if (Isa::readsMemory(opcode))
+        {
+            int cell = operand(address, 0);
+            if (cell >= 0 && !containsSorted(def, cell))
+                insertSorted(use, cell);
+        }
+        int cell = writtenCell(address);
+        if (cell >= 0)
+            insertSorted(def, cell);
+    }
+}
+
+// Lista de trabalho em ordem reversa: cada bloco é revisitado só quando um sucessor muda
+void ControlFlowGraph::liveness(BlockSets &liveIn, BlockSets &liveOut) const
+{
+    std::vector<std::vector<int>> use(blocks.size()), def(blocks.size());
+    std::vector<int> cells;
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+        blockUseDef(blocks[i], use[i], def[i]);
+        cells.insert(cells.end(), use[i].begin(), use[i].end());
+        cells.insert(cells.end(), def[i].begin(), def[i].end());
+    }
+    std::sort(cells.begin(), cells.end());
+    cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+    liveIn = BlockSets(blocks.size(), cells);
+    liveOut = BlockSets(blocks.size(), cells);
+
+    // use/def passam a ser posições no universo
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+        for (int &cell : use[i])
+            cell = static_cast<int>(liveIn.indexOf(cell));
+        for (int &cell : def[i])
+            cell = static_cast<int>(liveIn.indexOf(cell));
+    }
+
+    size_t words = liveIn.words;
+    std::vector<uint64_t> in(words);
+    std::vector<int> worklist;
+    std::vector<char> queued(blocks.size(), 1);
+    for (size_t i = 0; i < blocks.size(); ++i)
+        worklist.push_back(static_cast<int>(i));
+
+    while (!worklist.empty())
+    {
+        int index = worklist.back();
+        worklist.pop_back();
+        queued[index] = 0;
+
+        // Um desvio para fora do módulo pode ler qualquer célula
+        const BasicBlock &block = blocks[index];
+        uint64_t *out = liveOut.row(index);
+        std::fill(out, out + words, block.leavesModule ? ~uint64_t(0) : 0);
+        for (int successor : block.successors)
+        {
+            const uint64_t *successorIn = liveIn.row(successor);
+            for (size_t w = 0; w < words; ++w)
+                out[w] |= successorIn[w];
+        }
+        if (block.leavesModule && cells.size() % 64 != 0)
+            out[words - 1] &= (uint64_t(1) << (cells.size() % 64)) - 1;
+
+        std::copy(out, out + words, in.begin());
+        for (int cell : def[index])
+            clearBit(in.data(), cell);
+        for (int cell : use[index])
+            setBit(in.data(), cell);
+        uint64_t *current = liveIn.row(index);
+        if (!std::equal(in.begin(), in.end(), current))
+        {
+            std::copy(in.begin(), in.end(), current);
+            for (int predecessor : block.predecessors)
+            {
+                if (!queued[predecessor])
+                {
+                    queued[predecessor] = 1;
+                    worklist.push_back(predecessor);
+                }
+            }
+        }
+    }
+}
+
+BlockSets ControlFlowGraph::reachingDefinitions() const
+{
+    std::vector<std::vector<int>> gen(blocks.size()), written(blocks.size());
+    std::vector<int> definitions;
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+        // Apenas a última escrita de cada célula no bloco sai dele
+        std::vector<int> lastWriter;
+        for (int address = blocks[i].start; address < blocks[i].end; address += Isa::size(code[address]))
+        {
+            int cell = writtenCell(address);
+            if (cell < 0)
+                continue;
+            lastWriter.erase(std::remove_if(lastWriter.begin(), lastWriter.end(),
+                                            [&](int writer) { return writtenCell(writer) == cell; }),
+                             lastWriter.end());
+            lastWriter.push_back(address);
+            insertSorted(written[i], cell);
+        }
+        gen[i] = lastWriter;
+        definitions.insert(definitions.end(), lastWriter.begin(), lastWriter.end());
+    }
+    std::sort(definitions.begin(), definitions.end());
+    BlockSets in(blocks.size(), definitions), out(blocks.size(), definitions);
+
+    // Definições de cada célula, para matar as que um bloco sobrescreve
+    std::vector<std::pair<int, int>> byCell; // Célula, posição da definição no universo
+    for (size_t k = 0; k < definitions.size(); ++k)
+        byCell.push_back({writtenCell(definitions[k]), static_cast<int>(k)});
+    std::sort(byCell.begin(), byCell.end());
+    for (auto &writers : gen)
+    {
+        for (int &writer : writers)
+            writer = static_cast<int>(in.indexOf(writer));
+    }
+
+    size_t words = in.words;
+    std::vector<uint64_t> result(words);
+    std::vector<int> worklist;
+    std::vector<char> queued(blocks.size(), 1);
+    for (size_t i = blocks.size(); i-- > 0;)
+        worklist.push_back(static_cast<int>(i));
+
+    while (!worklist.empty())
+    {
+        int index = worklist.back();
+        worklist.pop_back();
+        queued[index] = 0;
+
+        uint64_t *reaching = in.row(index);
+        std::fill(reaching, reaching + words, 0);
+        for (int predecessor : blocks[index].predecessors)
+        {
+            const uint64_t *predecessorOut = out.row(predecessor);
+            for (size_t w = 0; w < words; ++w)
+                reaching[w] |= predecessorOut[w];
+        }
+
+        std::copy(reaching, reaching + words, result.begin());
+        for (int cell : written[index])
+        {
+            auto it = std::lower_bound(byCell.begin(), byCell.end(), std::make_pair(cell, -1));
+            for (; it != byCell.end() && it->first == cell; ++it)
+                clearBit(result.data(), it->second);
+        }
+        for (int writer : gen[index])
+            setBit(result.data(), writer);
+
+        uint64_t *current = out.row(index);
+        if (!std::equal(result.begin(), result.end(), current))
+        {
+            std::copy(result.begin(), result.end(), current);
+            for (int successor : blocks[index].successors)
+            {
+                if (!queued[successor])
+                {
+                    queued[successor] = 1;
+                    worklist.push_back(successor);
+                }
+            }
+        }
+    }
+    return in;
+}
+
+BlockSets::BlockSets(size_t blocks, std::vector<int> universe)
+    : universe(std::move(universe)), words((this->universe.size() + 63) / 64), bits(blocks * words, 0)
+{
+}
+
+size_t BlockSets::indexOf(int value) const
+{
+    return static_cast<size_t>(std::lower_bound(universe.begin(), universe.end(), value) - universe.begin());
+}
+
+uint64_t *BlockSets::row(int block)
+{
+    return bits.data() + static_cast<size_t>(block) * words;
+}
+
+const uint64_t *BlockSets::row(int block) const
+{
+    return bits.data() + static_cast<size_t>(block) * words;
+}
+
+bool BlockSets::contains(int block, int value) const
+{
+    size_t index = indexOf(value);
+    if (index == universe.size() || universe[index] != value)
+        return false;
+    return row(block)[index / 64] >> (index % 64) & 1;
+}
+
+std::vector<int> BlockSets::members(int block) const
+{
+    std::vector<int> result;
+    const uint64_t *bitsOfBlock = row(block);
+    for (size_t index = 0; index < universe.size(); ++index)
+    {
+        if (bitsOfBlock[index / 64] >> (index % 64) & 1)
+            result.push_back(universe[index]);
+    }
+    return result;
+}
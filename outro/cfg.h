@@ -0,0 +1,68 @@
+#ifndef CFG_H
+#define CFG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct BasicBlock
+{
+    int start; // Primeira palavra do bloco
+    int end;   // Uma posição após a última palavra
+    std::vector<int> successors;
+    std::vector<int> predecessors;
+    bool leavesModule = false; // Desvio para símbolo externo
+};
+
+// Um conjunto por bloco, guardado como bitset sobre um universo numerado em ordem crescente
+// (células, ou endereços de definições): as uniões das análises são OR de palavras de 64 bits,
+// e o custo de uma passada é blocos × universo / 64
+class BlockSets
+{
+public:
+    BlockSets() = default;
+    BlockSets(size_t blocks, std::vector<int> universe);
+    bool contains(int block, int value) const;
+    std::vector<int> members(int block) const; // Em ordem crescente
+
+private:
+    friend class ControlFlowGraph;
+    size_t indexOf(int value) const; // Posição de value no universo (que precisa contê-lo)
+    uint64_t *row(int block);
+    const uint64_t *row(int block) const;
+
+    std::vector<int> universe;
+    size_t words = 0; // Palavras de 64 bits por bloco
+    std::vector<uint64_t> bits;
+};
+
+class ControlFlowGraph
+{
+public:
+    ControlFlowGraph(const std::vector<int> &code, const std::vector<int> &entryPoints = {0},
+                     const std::vector<int> &externalReferences = {});
+    const std::vector<BasicBlock> &getBlocks() const;
+    bool isCode(int address) const;
+    bool isInstructionStart(int address) const;
+    int blockAt(int address) const;
+    std::vector<int> getDataAddresses() const;
+
+    // Células de memória vivas na entrada/saída de cada bloco
+    void liveness(BlockSets &liveIn, BlockSets &liveOut) const;
+    // Endereços das instruções que escrevem na memória e alcançam a entrada de cada bloco
+    BlockSets reachingDefinitions() const;
+
+private:
+    int operand(int address, int index) const;
+    void blockUseDef(const BasicBlock &block, std::vector<int> &use, std::vector<int> &def) const;
+    int writtenCell(int address) const;
+
+    std::vector<int> code;
+    std::vector<char> codeWord;
+    std::vector<char> instructionStart;
+    std::vector<char> external;
+    std::vector<int> blockOf;
+    std::vector<BasicBlock> blocks;
+};
+
+#endif // CFG_H
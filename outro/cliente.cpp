@@ -0,0 +1,95 @@
+#include <filesystem>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include "server.h"
+#include "utils.h"
+
+// Cliente do servidor de montagem: mesmos modos do montador, sem iniciar o montador
+namespace
+{
+    std::string readFile(const std::string &path)
+    {
+        std::ifstream input(path);
+        if (!input)
+            throw std::runtime_error("Error: Could not open input file: " + path);
+        std::stringstream content;
+        content << input.rdbuf();
+        return content.str();
+    }
+
+    void writeFile(const std::string &path, const std::string &content)
+    {
+        std::ofstream output(path);
+        if (!output)
+            throw std::runtime_error("Error: Could not open output file: " + path);
+        output << content;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " socket -p input.asm | -o input.pre | -l prog.e a.obj b.obj... | -r prog.e [inputs.txt] | -s" << std::endl;
+        return 1;
+    }
+
+    std::string socketPath = argv[1];
+    std::string mode = argv[2];
+
+    try
+    {
+        if (mode == "-p" && argc > 3)
+        {
+            // INCLUDE é relativo ao fonte, não ao diretório do servidor
+            std::string directory = std::filesystem::absolute(argv[3]).parent_path().string();
+            writeFile(Utils::replaceExtension(argv[3], ".pre"), Server::request(socketPath, "preprocess", {readFile(argv[3]), directory}));
+        }
+        else if (mode == "-o" && argc > 3)
+        {
+            writeFile(Utils::replaceExtension(argv[3], ".obj"), Server::request(socketPath, "assemble", {readFile(argv[3])}));
+        }
+        else if (mode == "-l" && argc > 4)
+        {
+            std::vector<std::string> objects;
+            for (int i = 4; i < argc; ++i)
+                objects.push_back(readFile(argv[i]));
+            writeFile(argv[3], Server::request(socketPath, "link", objects));
+        }
+        else if (mode == "-r" && argc > 3)
+        {
+            std::string inputs;
+            if (argc > 4)
+            {
+                inputs = readFile(argv[4]);
+            }
+            else
+            {
+                std::stringstream values;
+                values << std::cin.rdbuf();
+                inputs = values.str();
+            }
+            std::cout << Server::request(socketPath, "run", {readFile(argv[3]), inputs});
+        }
+        else if (mode == "-s")
+        {
+            std::cout << Server::request(socketPath, "stats", {});
+        }
+        else
+        {
+            std::cerr << "Unknown mode: " << mode << std::endl;
+            return 1;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
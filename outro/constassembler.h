@@ -0,0 +1,294 @@
+#ifndef CONSTASSEMBLER_H
+#define CONSTASSEMBLER_H
+
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include "assembler.h"
+#include "isa.h"
+#include "lexer.h"
+
+// Montagem em tempo de compilação de programas pequenos e autocontidos, para embutir em
+// tabelas e testes sem montar nada na inicialização:
+//
+//     constexpr auto program = assembleProgram(R"(
+//         INPUT N
+//         OUTPUT N
+//         STOP
+//     N: SPACE
+//     )");
+//     constexpr std::array<int, program.size> words = embeddedWords<program.size>(program);
+//
+// O fonte é o do montador já pré-processado (sem EQU, IF ou MACRO), com SECTION TEXT/DATA,
+// SPACE, CONST e operandos SIMBOLO op N. Não há ligador: EXTERN é erro e todo símbolo precisa
+// estar definido. Um erro de montagem é erro de compilação, e a mensagem do compilador traz a
+// linha do fonte no índice do vetor assemblyErrorOnSourceLine; fora de tempo de compilação,
+// o erro é uma exceção.
+
+struct EmbeddedSymbol
+{
+    std::string_view name; // Aponta para o fonte
+    int address = 0;
+};
+
+template <size_t MaxWords, size_t MaxSymbols>
+struct EmbeddedProgram
+{
+    std::array<int, MaxWords> words{};
+    std::array<char, MaxWords> relocation{}; // '1' nas palavras com endereço, como no REAL do objeto
+    std::array<EmbeddedSymbol, MaxSymbols> symbols{};
+    size_t size = 0;
+    size_t textSize = 0; // Palavras da seção TEXT; as seguintes são DATA
+    size_t symbolCount = 0;
+
+    // Endereço do símbolo, ou -1
+    constexpr int address(std::string_view name) const
+    {
+        for (size_t i = 0; i < symbolCount; ++i)
+        {
+            if (symbols[i].name == name)
+                return symbols[i].address;
+        }
+        return -1;
+    }
+};
+
+// As mesmas duas passagens do montador, sobre buffers de tamanho fixo: a primeira calcula
+// o tamanho de cada seção e o endereço de cada rótulo, a segunda gera as palavras
+template <size_t MaxWords, size_t MaxSymbols>
+class ConstAssembler
+{
+public:
+    using Program = EmbeddedProgram<MaxWords, MaxSymbols>;
+
+    static constexpr Program assemble(std::string_view source)
+    {
+        Program program;
+        State state;
+        forEachLine(source, [&](const Line &line)
+                    { firstPass(line, program, state); });
+
+        // DATA vem depois de todo o TEXT
+        program.textSize = state.counters[TextSection];
+        program.size = state.counters[TextSection] + state.counters[DataSection];
+        for (size_t i = 0; i < program.symbolCount; ++i)
+        {
+            if (state.symbolSections[i] == DataSection)
+                program.symbols[i].address += static_cast<int>(program.textSize);
+        }
+
+        state.counters[TextSection] = 0;
+        state.counters[DataSection] = program.textSize;
+        state.section = TextSection;
+        forEachLine(source, [&](const Line &line)
+                    { secondPass(line, program, state); });
+        return program;
+    }
+
+    // Em tempo de compilação, o índice fora dos limites faz o compilador citar o número da linha
+    // ("array subscript value 'N' is outside the bounds of array 'assemblyErrorOnSourceLine'"),
+    // e a mensagem aparece nos argumentos desta chamada no contexto do erro
+    static constexpr void require(bool condition, const char *message, size_t line)
+    {
+        if (condition)
+            return;
+#if defined(__GNUC__)
+        if (__builtin_is_constant_evaluated())
+        {
+            const char assemblyErrorOnSourceLine[1] = {};
+            if (assemblyErrorOnSourceLine[line] == 0)
+                throw std::logic_error(message);
+        }
+#endif
+        throw std::runtime_error("Error: line " + std::to_string(line) + ": " + message);
+    }
+
+private:
+    // Seção corrente e contadores de posição de cada seção (na segunda passagem, já com a base)
+    struct State
+    {
+        size_t counters[SectionCount] = {0, 0};
+        Section section = TextSection;
+        std::array<Section, MaxSymbols> symbolSections{};
+    };
+
+    struct Line
+    {
+        size_t number; // 1 em diante, como nos diagnósticos do montador
+        std::string_view label;
+        std::string_view opcode;
+        std::string_view operands; // Resto da linha depois do código
+    };
+
+    template <typename Visit>
+    static constexpr void forEachLine(std::string_view source, Visit visit)
+    {
+        for (size_t number = 1;; ++number)
+        {
+            size_t end = source.find('\n');
+            std::string_view text = Lexer::stripComment(source.substr(0, end));
+            Line line{number, {}, {}, {}};
+            size_t position = 0;
+            std::string_view token = Lexer::nextToken(text, position);
+            if (!token.empty() && token.back() == ':')
+            {
+                line.label = token.substr(0, token.size() - 1);
+                token = Lexer::nextToken(text, position);
+            }
+            line.opcode = token;
+            line.operands = text.substr(position);
+            if (!line.label.empty() || !line.opcode.empty())
+                visit(line);
+            if (end == std::string_view::npos)
+                return;
+            source.remove_prefix(end + 1);
+        }
+    }
+
+    // Operandos separados por vírgula; uma lista só de espaços não tem operandos
+    static constexpr size_t splitOperands(std::string_view text, std::string_view (&operands)[2], size_t line)
+    {
+        if (Lexer::trim(text).empty())
+            return 0;
+        size_t count = 0;
+        while (true)
+        {
+            size_t comma = text.find(',');
+            require(count < 2, "Too many operands", line);
+            operands[count++] = text.substr(0, comma);
+            if (comma == std::string_view::npos)
+                return count;
+            text = text.substr(comma + 1);
+        }
+    }
+
+    // Números pelas mesmas regras do montador (Lexer::parseDecimal): só decimal, dentro de int
+    static constexpr int parseNumber(std::string_view text, size_t line)
+    {
+        int value = 0;
+        require(Lexer::parseDecimal(Lexer::trim(text), value), "Invalid number", line);
+        return value;
+    }
+
+    static constexpr bool isSection(const Line &line, State &state)
+    {
+        if (line.opcode != "SECTION")
+            return false;
+        std::string_view name = Lexer::trim(line.operands);
+        require(name == "TEXT" || name == "DATA", "Invalid section", line.number);
+        state.section = name == "TEXT" ? TextSection : DataSection;
+        return true;
+    }
+
+    static constexpr void firstPass(const Line &line, Program &program, State &state)
+    {
+        // A troca de seção vem antes do rótulo: "L: SECTION DATA" marca o início dos dados
+        bool section = isSection(line, state);
+        size_t &counter = state.counters[state.section];
+        if (!line.label.empty())
+        {
+            require(Lexer::isLabel(line.label), "Invalid label", line.number);
+            require(program.address(line.label) < 0, "Redefinition of symbol", line.number);
+            require(program.symbolCount < MaxSymbols, "Too many symbols for MaxSymbols", line.number);
+            require(line.opcode != "EXTERN", "EXTERN needs the linker; embedded programs must be self-contained", line.number);
+            state.symbolSections[program.symbolCount] = state.section;
+            program.symbols[program.symbolCount++] = {line.label, static_cast<int>(counter)};
+        }
+
+        if (line.opcode.empty() || section || line.opcode == "BEGIN" || line.opcode == "END" || line.opcode == "PUBLIC")
+            return;
+        if (line.opcode == "SPACE")
+        {
+            std::string_view size = Lexer::trim(line.operands);
+            require(size.empty() || Lexer::isNumber(size), "Invalid operand for SPACE directive", line.number);
+            counter += size.empty() ? 1 : static_cast<size_t>(parseNumber(size, line.number));
+        }
+        else if (line.opcode == "CONST")
+        {
+            require(!Lexer::trim(line.operands).empty(), "Missing operand for CONST directive", line.number);
+            counter += 1;
+        }
+        else
+        {
+            const InstructionInfo *info = Isa::lookup(line.opcode);
+            require(info != nullptr, "Invalid opcode", line.number);
+            std::string_view operands[2];
+            require(splitOperands(line.operands, operands, line.number) == static_cast<size_t>(info->operands),
+                    "Wrong number of operands", line.number);
+            counter += static_cast<size_t>(info->operands) + 1;
+        }
+        require(state.counters[TextSection] + state.counters[DataSection] <= MaxWords, "Program larger than MaxWords", line.number);
+    }
+
+    static constexpr void secondPass(const Line &line, Program &program, State &state)
+    {
+        if (isSection(line, state))
+            return;
+        size_t &position = state.counters[state.section];
+        if (line.opcode == "SPACE")
+        {
+            std::string_view size = Lexer::trim(line.operands);
+            for (int i = size.empty() ? 1 : parseNumber(size, line.number); i > 0; --i)
+                emit(program, position, 0, '0');
+        }
+        else if (line.opcode == "CONST")
+        {
+            emit(program, position, parseNumber(line.operands, line.number), '0');
+        }
+        else if (const InstructionInfo *info = Isa::lookup(line.opcode))
+        {
+            emit(program, position, info->opcode, '0');
+            std::string_view operands[2];
+            size_t count = splitOperands(line.operands, operands, line.number);
+            for (size_t i = 0; i < count; ++i)
+                emitOperand(program, position, operands[i], line.number);
+        }
+    }
+
+    // Imediato, SIMBOLO ou SIMBOLO op N; só endereços (SIMBOLO, + e -) são relocáveis
+    static constexpr void emitOperand(Program &program, size_t &position, std::string_view text, size_t line)
+    {
+        OperandText operand;
+        require(Lexer::splitOperand(text, operand), "Invalid expression", line);
+        if (operand.symbol.empty())
+        {
+            emit(program, position, parseNumber(operand.number, line), '0');
+            return;
+        }
+
+        int address = program.address(operand.symbol);
+        require(address >= 0, "Undefined symbol", line);
+        int value = 0;
+        require(Lexer::applyOperator(address, operand.op, operand.number.empty() ? 0 : parseNumber(operand.number, line), value),
+                "Invalid division", line);
+        emit(program, position, value, Lexer::isRelocatable(operand.op) ? '1' : '0');
+    }
+
+    static constexpr void emit(Program &program, size_t &position, int word, char relocation)
+    {
+        program.words[position] = word;
+        program.relocation[position] = relocation;
+        ++position;
+    }
+};
+
+template <size_t MaxWords = 256, size_t MaxSymbols = 64>
+constexpr EmbeddedProgram<MaxWords, MaxSymbols> assembleProgram(std::string_view source)
+{
+    return ConstAssembler<MaxWords, MaxSymbols>::assemble(source);
+}
+
+// Palavras do programa num std::array do tamanho exato (Size deve ser program.size)
+template <size_t Size, size_t MaxWords, size_t MaxSymbols>
+constexpr std::array<int, Size> embeddedWords(const EmbeddedProgram<MaxWords, MaxSymbols> &program)
+{
+    ConstAssembler<MaxWords, MaxSymbols>::require(Size == program.size, "Size differs from the program size", 0);
+    std::array<int, Size> words{};
+    for (size_t i = 0; i < Size; ++i)
+        words[i] = program.words[i];
+    return words;
+}
+
+#endif // CONSTASSEMBLER_H
@@ -0,0 +1,77 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "disassembler.h"
+#include "executable.h"
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <file.obj|file.e> [-t threads] [-o output.txt] [-text]" << std::endl;
+        return 1;
+    }
+
+    std::string inputFile = argv[1];
+    std::string outputFile;
+    bool text = false;
+    unsigned threads = std::thread::hardware_concurrency();
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-t" && i + 1 < argc)
+        {
+            threads = std::stoul(argv[++i]);
+        }
+        else if (arg == "-o" && i + 1 < argc)
+        {
+            outputFile = argv[++i];
+        }
+        else if (arg == "-text")
+        {
+            text = true; // Exporta o executável no formato de texto em vez de desmontar
+        }
+        else
+        {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    try
+    {
+        std::ofstream file;
+        if (!outputFile.empty())
+        {
+            file.open(outputFile);
+            if (!file)
+            {
+                std::cerr << "Error: Could not open output file: " << outputFile << std::endl;
+                return 1;
+            }
+        }
+        else
+        {
+            std::ios::sync_with_stdio(false);
+        }
+        std::ostream &output = outputFile.empty() ? std::cout : file;
+
+        if (text)
+        {
+            Executable::writeText(Executable::read(inputFile), output);
+            return 0;
+        }
+        DisassemblyInput input = DisassemblyInput::load(inputFile);
+        Disassembler disassembler(input);
+        disassembler.setThreads(threads);
+        disassembler.write(output);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
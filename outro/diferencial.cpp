@@ -0,0 +1,159 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "assembler.h"
+#include "differential.h"
+#include "generator.h"
+#include "incremental.h"
+#include "preprocessor.h"
+
+namespace
+{
+    std::vector<std::string> splitLines(const std::string &text)
+    {
+        std::vector<std::string> lines;
+        std::istringstream input(text);
+        std::string line;
+        while (std::getline(input, line))
+            lines.push_back(line);
+        return lines;
+    }
+
+    // Programa gerado e já pré-processado, com opções sorteadas
+    std::vector<std::string> generateBase(std::mt19937 &rng)
+    {
+        GeneratorOptions options;
+        options.lines = 10 + rng() % 150;
+        options.labelDensity = (rng() % 60) / 100.0;
+        options.forwardRatio = (rng() % 100) / 100.0;
+        options.equCount = rng() % 6;
+        options.expressionRatio = (rng() % 40) / 100.0;
+        options.seed = rng();
+        std::istringstream source(ProgramGenerator(options).generate()[0]);
+        std::ostringstream output;
+        Preprocessor().preprocess(source, output);
+        return splitLines(output.str());
+    }
+
+    // Mutações de linha inteira e de token; o repertório inclui linhas inválidas de propósito
+    void mutate(std::vector<std::string> &lines, std::mt19937 &rng)
+    {
+        static const std::vector<std::string> pool = {
+            "STOP", "LOAD D0_0", "ADD D0_1 + 1", "SUB D0_2 * 2", "MULT D0_0 / 2", "COPY D0_0,D0_1", "JMP L0_0",
+            "X: SPACE 3", "Y: CONST 7", "E: EXTERN", "STORE E", "JMPZ E + 2", "PUBLIC D0_0", "PUBLIC Z",
+            "SECTION DATA", "SECTION TEXT", "SECTION FOO", "M: BEGIN", "END", "BOGUS 1", "LOAD", "COPY D0_0",
+            "L0_0: ADD D0_0", "D0_0: SPACE", "ADD 5", "ADD UNDEFINED", "; comentário", "", "INPUT D0_1, D0_2"};
+        if (lines.empty())
+        {
+            lines.push_back(pool[rng() % pool.size()]);
+            return;
+        }
+        size_t at = rng() % lines.size();
+        switch (rng() % 5)
+        {
+        case 0:
+            lines.erase(lines.begin() + at);
+            break;
+        case 1:
+            lines.insert(lines.begin() + at, lines[rng() % lines.size()]);
+            break;
+        case 2:
+            std::swap(lines[at], lines[rng() % lines.size()]);
+            break;
+        case 3:
+            lines.insert(lines.begin() + at, pool[rng() % pool.size()]);
+            break;
+        default:
+        {
+            // Troca um token por outro de uma linha qualquer
+            std::istringstream words(lines[rng() % lines.size()]);
+            std::vector<std::string> donors;
+            std::string word;
+            while (words >> word)
+                donors.push_back(word);
+            std::string &line = lines[at];
+            size_t space = line.find(' ');
+            if (!donors.empty() && space != std::string::npos)
+                line = line.substr(0, space + 1) + donors[rng() % donors.size()];
+            break;
+        }
+        }
+    }
+}
+
+// Roda programas gerados e mutados pela montagem serial (referência) e pelos caminhos rápidos:
+// montagem paralela com trechos minúsculos e montagem incremental sobre a sequência de casos
+int main(int argc, char *argv[])
+{
+    size_t cases = 10000;
+    uint32_t seed = 1;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string arg = argv[i];
+        if (arg == "-n")
+            cases = std::stoul(argv[i + 1]);
+        else if (arg == "-s")
+            seed = std::stoul(argv[i + 1]);
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [-n cases] [-s seed]" << std::endl;
+            return 1;
+        }
+    }
+
+    DifferentialHarness harness("serial", [](const std::vector<std::string> &lines)
+                                { return Assembler().assembleObject(lines); });
+    harness.addEngine("chunked", [](const std::vector<std::string> &lines)
+                      {
+                          Assembler assembler;
+                          assembler.setThreads(3);
+                          assembler.setMinimumChunkLines(4);
+                          return assembler.assembleObject(lines); });
+    IncrementalAssembler incremental;
+    harness.addEngine("incremental", [&incremental](const std::vector<std::string> &lines)
+                      { return incremental.assemble(lines); });
+
+    std::mt19937 rng(seed);
+    std::vector<std::string> base;
+    size_t failing = 0;
+    auto start = std::chrono::steady_clock::now();
+    try
+    {
+        for (size_t i = 0; i < cases; ++i)
+        {
+            // Uma base nova a cada 20 casos; os casos seguintes são variações dela, o que
+            // também exercita a montagem incremental com edições pequenas
+            if (i % 20 == 0)
+                base = generateBase(rng);
+            std::vector<std::string> lines = base;
+            for (size_t m = rng() % 4; m > 0; --m)
+                mutate(lines, rng);
+
+            Assembler reference;
+            failing += reference.assembleObject(lines).ok() ? 0 : 1;
+            std::string divergence = harness.compare(lines);
+            if (divergence.empty())
+                continue;
+
+            std::cout << "Case " << i << ": " << divergence << std::endl;
+            std::vector<std::string> minimal = harness.minimize(lines);
+            std::cout << "Minimized to " << minimal.size() << " lines (" << harness.compare(minimal) << "):" << std::endl;
+            for (const auto &line : minimal)
+                std::cout << line << std::endl;
+            return 1;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << cases << " cases agree (" << failing << " with errors), " << static_cast<long>(cases / seconds) << " cases/s" << std::endl;
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include "differential.h"
+#include <algorithm>
+
+DifferentialHarness::DifferentialHarness(const std::string &referenceName, const AssemblerEngine &reference)
+    : reference{referenceName, reference}
+{
+}
+
+void DifferentialHarness::addEngine(const std::string &name, const AssemblerEngine &engine)
+{
+    engines.push_back({name, engine});
+}
+
+std::string DifferentialHarness::compare(const std::vector<std::string> &lines)
+{
+    ObjectCode expected = reference.assemble(lines);
+    for (const auto &engine : engines)
+    {
+        std::string result = difference(expected, engine.assemble(lines));
+        if (!result.empty())
+            return engine.name + " vs " + reference.name + ": " + result;
+    }
+    return "";
+}
+
+std::string DifferentialHarness::difference(const ObjectCode &expected, const ObjectCode &actual)
+{
+    if (expected.diagnostics.size() != actual.diagnostics.size())
+        return "diagnostic count " + std::to_string(expected.diagnostics.size()) + " vs " + std::to_string(actual.diagnostics.size());
+    for (size_t i = 0; i < expected.diagnostics.size(); ++i)
+    {
+        const Diagnostic &a = expected.diagnostics[i];
+        const Diagnostic &b = actual.diagnostics[i];
+        if (a.line != b.line || a.message != b.message || a.isError != b.isError)
+            return "diagnostic " + std::to_string(i) + " '" + std::to_string(a.line) + ": " + a.message + "' vs '" +
+                   std::to_string(b.line) + ": " + b.message + "'";
+    }
+    if (!expected.ok())
+        return ""; // Com erro, o conteúdo parcial do objeto não é especificado
+
+    if (expected.code.size() != actual.code.size())
+        return "code size " + std::to_string(expected.code.size()) + " vs " + std::to_string(actual.code.size());
+    for (size_t i = 0; i < expected.code.size(); ++i)
+    {
+        if (expected.code[i] != actual.code[i])
+            return "word " + std::to_string(i) + " is " + std::to_string(expected.code[i]) + " vs " + std::to_string(actual.code[i]);
+    }
+    if (expected.relocation != actual.relocation)
+        return "relocation '" + expected.relocation + "' vs '" + actual.relocation + "'";
+    if (expected.textSize != actual.textSize)
+        return "TEXT size " + std::to_string(expected.textSize) + " vs " + std::to_string(actual.textSize);
+    if (expected.definitions != actual.definitions)
+        return "definition table differs";
+    if (expected.usages != actual.usages)
+        return "usage table differs";
+    return "";
+}
+
+// ddmin: tenta tirar cada um de n pedaços; se a divergência some com todos, dobra n
+std::vector<std::string> DifferentialHarness::minimize(const std::vector<std::string> &lines)
+{
+    std::vector<std::string> current = lines;
+    size_t parts = 2;
+    while (current.size() >= 2)
+    {
+        size_t chunk = (current.size() + parts - 1) / parts;
+        bool reduced = false;
+        for (size_t start = 0; start < current.size(); start += chunk)
+        {
+            std::vector<std::string> candidate(current.begin(), current.begin() + start);
+            candidate.insert(candidate.end(), current.begin() + std::min(current.size(), start + chunk), current.end());
+            if (!compare(candidate).empty())
+            {
+                current = std::move(candidate);
+                parts = std::max<size_t>(parts - 1, 2);
+                reduced = true;
+                break;
+            }
+        }
+        if (!reduced)
+        {
+            if (parts >= current.size())
+                break;
+            parts = std::min(parts * 2, current.size());
+        }
+    }
+    return current;
+}
@@ -0,0 +1,38 @@
+#ifndef DIFFERENTIAL_H
+#define DIFFERENTIAL_H
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "assembler.h"
+
+// Um caminho de montagem: recebe as linhas já pré-processadas e devolve o objeto em memória
+using AssemblerEngine = std::function<ObjectCode(const std::vector<std::string> &)>;
+
+// Compara caminhos de montagem com a referência: palavras, relocação, tabelas de definição e
+// de uso e diagnósticos precisam ser idênticos
+class DifferentialHarness
+{
+public:
+    DifferentialHarness(const std::string &referenceName, const AssemblerEngine &reference);
+    void addEngine(const std::string &name, const AssemblerEngine &engine);
+
+    // Primeira divergência encontrada ("" quando todos concordam)
+    std::string compare(const std::vector<std::string> &lines);
+    // Remove linhas enquanto a divergência persistir (delta debugging sobre linhas)
+    std::vector<std::string> minimize(const std::vector<std::string> &lines);
+
+    static std::string difference(const ObjectCode &expected, const ObjectCode &actual);
+
+private:
+    struct Engine
+    {
+        std::string name;
+        AssemblerEngine assemble;
+    };
+
+    Engine reference;
+    std::vector<Engine> engines;
+};
+
+#endif // DIFFERENTIAL_H
@@ -0,0 +1,273 @@
+#include "disassembler.h"
+#include "executable.h"
+#include "isa.h"
+#include "linker.h"
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+    void appendNumber(std::string &buffer, int value)
+    {
+        char digits[16];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        buffer.append(digits, result.ptr);
+    }
+
+    void pad(std::string &buffer, size_t from, size_t width)
+    {
+        size_t used = buffer.size() - from;
+        buffer.append(used < width ? width - used : 1, ' ');
+    }
+
+    int textWords(const DisassemblyInput &input)
+    {
+        int size = static_cast<int>(input.code.size());
+        return input.textSize < 0 ? size : std::min(input.textSize, size);
+    }
+
+    // A entrada e os rótulos do TEXT são pontos de entrada possíveis (rotinas chamadas por
+    // outros módulos). Sem seções, a tabela mistura rótulos de CONST, que não são código
+    std::vector<int> entryPoints(const DisassemblyInput &input)
+    {
+        std::vector<int> entries = {input.entry};
+        if (input.textSize < 0)
+            return entries;
+        for (const auto &definition : input.definitions)
+        {
+            if (definition.second < textWords(input))
+                entries.push_back(definition.second);
+        }
+        return entries;
+    }
+
+    std::vector<int> usagePositions(const DisassemblyInput &input)
+    {
+        std::vector<int> positions;
+        for (const auto &usage : input.usages)
+            positions.push_back(usage.second);
+        return positions;
+    }
+}
+
+// Executáveis binários trazem seções, relocação e símbolos no próprio formato. Objetos e
+// executáveis de texto têm o mesmo leitor do ligador: as palavras e, se houver, as tabelas
+// DEFINITION TABLE/USAGE TABLE, REAL e SECTIONS
+DisassemblyInput DisassemblyInput::load(const std::string &file)
+{
+    DisassemblyInput input;
+    if (Executable::isBinary(file))
+    {
+        ExecutableImage image = Executable::read(file);
+        input.code = std::move(image.code);
+        input.relocation = std::move(image.relocation);
+        input.textSize = image.textSize;
+        input.entry = image.entry;
+        input.definitions = std::move(image.symbols);
+    }
+    else
+    {
+        std::ifstream stream(file);
+        if (!stream)
+            throw std::runtime_error("Error: Could not open input file: " + file);
+        Module module = Linker::readModule(stream, file);
+        input.code = std::move(module.code);
+        input.relocation = std::move(module.relocationTable);
+        input.textSize = module.textSize;
+        input.definitions.assign(module.definitionTable.begin(), module.definitionTable.end());
+        input.usages = std::move(module.usageTable);
+    }
+    std::sort(input.definitions.begin(), input.definitions.end(), [](const auto &a, const auto &b)
+              { return a.second != b.second ? a.second < b.second : a.first < b.first; });
+    return input;
+}
+
+Disassembler::Disassembler(const DisassemblyInput &input)
+    : input(input), labelAt(input.code.size(), -1), externalAt(input.code.size(), -1), textEnd(textWords(input)),
+      flow(input.code, entryPoints(input), usagePositions(input))
+{
+    int size = static_cast<int>(input.code.size());
+    // Definições em ordem de endereço: o primeiro rótulo de cada endereço abre a sequência deles
+    for (int i = static_cast<int>(input.definitions.size()) - 1; i >= 0; --i)
+    {
+        int address = input.definitions[i].second;
+        if (address >= 0 && address < size)
+            labelAt[address] = i;
+    }
+    for (size_t i = 0; i < input.usages.size(); ++i)
+    {
+        int position = input.usages[i].second;
+        if (position >= 0 && position < size)
+            externalAt[position] = static_cast<int>(i);
+    }
+}
+
+void Disassembler::setThreads(unsigned count)
+{
+    threads = std::max(1u, count);
+}
+
+void Disassembler::setMinimumChunkWords(size_t words)
+{
+    minimumChunkWords = std::max<size_t>(1, words);
+}
+
+// Instrução alcançada pelo grafo de fluxo, ou, fora do código que ele encontrou, varredura
+// linear: no TEXT, código válido que cabe na seção é instrução; o resto é dado. Num objeto,
+// os operandos precisam ser relocáveis ou externos, e nenhum pode ter rótulo
+bool Disassembler::isInstruction(int address) const
+{
+    int length = address < textEnd ? Isa::size(input.code[address]) : 0;
+    if (length == 0 || address + length > textEnd)
+        return false;
+    if (flow.isInstructionStart(address))
+        return true;
+    for (int i = address; i < address + length; ++i)
+    {
+        // Não pode engolir palavras de instruções que o grafo já achou
+        if (flow.isCode(i))
+            return false;
+    }
+    for (int i = address + 1; i < address + length; ++i)
+    {
+        if (labelAt[i] >= 0)
+            return false;
+        bool relocatable = static_cast<size_t>(i) < input.relocation.size() && input.relocation[i] == '1';
+        if (!input.relocation.empty() && !relocatable && externalAt[i] < 0)
+            return false;
+    }
+    return true;
+}
+
+// Início de cada trecho. Achar os limites de instrução é só somar tamanhos, o que é barato
+// perto da formatação; no DATA toda palavra é um limite
+std::vector<int> Disassembler::chunkStarts() const
+{
+    int size = static_cast<int>(input.code.size());
+    size_t count = std::max<size_t>(1, std::min<size_t>(threads, input.code.size() / minimumChunkWords));
+    std::vector<int> starts = {0};
+    int address = 0;
+    for (size_t k = 1; k < count; ++k)
+    {
+        int target = static_cast<int>(input.code.size() * k / count);
+        while (address < target && address < textEnd)
+            address += isInstruction(address) ? Isa::size(input.code[address]) : 1;
+        address = std::max(address, target);
+        if (address > starts.back() && address < size)
+            starts.push_back(address);
+    }
+    starts.push_back(size);
+    return starts;
+}
+
+std::vector<std::string> Disassembler::decodeChunks() const
+{
+    std::vector<int> starts = chunkStarts();
+    std::vector<std::string> buffers(starts.size() - 1);
+    auto task = [&](size_t i)
+    { decode(starts[i], starts[i + 1], buffers[i]); };
+    if (buffers.size() == 1)
+    {
+        task(0);
+        return buffers;
+    }
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < buffers.size(); ++i)
+        workers.emplace_back(task, i);
+    for (auto &worker : workers)
+        worker.join();
+    return buffers;
+}
+
+void Disassembler::write(std::ostream &output) const
+{
+    for (const auto &buffer : decodeChunks())
+        output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+}
+
+std::string Disassembler::disassemble() const
+{
+    std::string text;
+    for (const auto &buffer : decodeChunks())
+        text += buffer;
+    return text;
+}
+
+// Linha: endereço, palavras (' nas relocáveis), rótulos e a instrução ou CONST
+void Disassembler::decode(int begin, int end, std::string &buffer) const
+{
+    buffer.reserve(static_cast<size_t>(end - begin) * 24);
+    int address = begin;
+    while (address < end)
+    {
+        if (address == textEnd && textEnd > 0)
+            buffer += "SECTION DATA\n";
+        bool instruction = isInstruction(address);
+        int length = instruction ? Isa::size(input.code[address]) : 1;
+
+        size_t line = buffer.size();
+        appendNumber(buffer, address);
+        pad(buffer, line, 8);
+        size_t column = buffer.size();
+        for (int i = 0; i < length; ++i)
+        {
+            appendNumber(buffer, input.code[address + i]);
+            if (static_cast<size_t>(address + i) < input.relocation.size() && input.relocation[address + i] == '1')
+                buffer += '\'';
+            buffer += ' ';
+        }
+        pad(buffer, column, 20);
+
+        column = buffer.size();
+        for (int label = labelAt[address];
+             label >= 0 && label < static_cast<int>(input.definitions.size()) && input.definitions[label].second == address; ++label)
+        {
+            buffer += input.definitions[label].first;
+            buffer += ": ";
+        }
+        pad(buffer, column, 12);
+
+        if (instruction)
+        {
+            const InstructionInfo *info = Isa::find(input.code[address]);
+            buffer += info->mnemonic;
+            for (int i = 1; i < length; ++i)
+            {
+                buffer += i == 1 ? " " : ",";
+                appendOperand(address + i, buffer);
+            }
+        }
+        else
+        {
+            buffer += "CONST ";
+            appendNumber(buffer, input.code[address]);
+        }
+        buffer += '\n';
+        address += length;
+    }
+}
+
+// Símbolo externo (com o deslocamento deixado pelo montador), rótulo do endereço ou número
+void Disassembler::appendOperand(int position, std::string &buffer) const
+{
+    int value = input.code[position];
+    if (externalAt[position] >= 0)
+    {
+        buffer += input.usages[externalAt[position]].first;
+        if (value > 0)
+            buffer += " + ";
+        else if (value < 0)
+            buffer += " - ";
+        if (value != 0)
+            appendNumber(buffer, value < 0 ? -value : value);
+        return;
+    }
+    bool address = input.relocation.empty() || (static_cast<size_t>(position) < input.relocation.size() && input.relocation[position] == '1');
+    if (address && value >= 0 && value < static_cast<int>(labelAt.size()) && labelAt[value] >= 0)
+        buffer += input.definitions[labelAt[value]].first;
+    else
+        appendNumber(buffer, value);
+}
@@ -0,0 +1,54 @@
+#ifndef DISASSEMBLER_H
+#define DISASSEMBLER_H
+
+#include "cfg.h"
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Imagem a desmontar: objeto (.obj) ou executável (.e), com as tabelas que existirem
+struct DisassemblyInput
+{
+    std::vector<int> code;
+    std::string relocation; // '1' nas palavras relativas; vazio em executáveis
+    int textSize = -1;      // Palavras da seção TEXT; -1 quando tudo é TEXT
+    int entry = 0;          // Primeira instrução executada
+    std::vector<std::pair<std::string, int>> definitions;
+    std::vector<std::pair<std::string, int>> usages; // Símbolo externo e posição da palavra
+
+    static DisassemblyInput load(const std::string &file);
+};
+
+// Decodifica a imagem de volta para mnemônicos, com rótulos da tabela de definições,
+// símbolos externos nas palavras da tabela de uso e ' nas palavras relocáveis. O código
+// alcançado a partir da entrada e dos rótulos do TEXT vem do grafo de fluxo; o resto do TEXT
+// passa pela varredura linear.
+// Imagens grandes são divididas em trechos que começam em limites de instrução; cada thread
+// formata o seu trecho num buffer próprio e os buffers são escritos na ordem
+class Disassembler
+{
+public:
+    explicit Disassembler(const DisassemblyInput &input);
+    void setThreads(unsigned count);
+    void setMinimumChunkWords(size_t words);
+    void write(std::ostream &output) const;
+    std::string disassemble() const;
+
+private:
+    std::vector<int> chunkStarts() const;
+    std::vector<std::string> decodeChunks() const;
+    void decode(int begin, int end, std::string &buffer) const;
+    void appendOperand(int position, std::string &buffer) const;
+    bool isInstruction(int address) const;
+
+    const DisassemblyInput &input;
+    std::vector<int> labelAt;    // Índice em definitions do rótulo do endereço, ou -1
+    std::vector<int> externalAt; // Índice em usages da palavra, ou -1
+    int textEnd;
+    ControlFlowGraph flow;
+    unsigned threads = 1;
+    size_t minimumChunkWords = 1 << 16; // Trechos menores não compensam criar uma thread
+};
+
+#endif // DISASSEMBLER_H
@@ -0,0 +1,133 @@
+#include "driver.h"
+#include "assembler.h"
+#include "preprocessor.h"
+#include "utils.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+BatchDriver::BatchDriver(unsigned threads)
+    : threads(std::max(1u, threads))
+{
+}
+
+// Expande diretórios em seus arquivos .asm/.pre (um .asm tem prioridade sobre o .pre de mesmo nome)
+std::vector<std::string> BatchDriver::collectInputs(const std::vector<std::string> &paths)
+{
+    std::vector<std::string> files;
+    for (const auto &path : paths)
+    {
+        if (!std::filesystem::is_directory(path))
+        {
+            files.push_back(path);
+            continue;
+        }
+
+        std::set<std::string> found;
+        for (const auto &entry : std::filesystem::directory_iterator(path))
+        {
+            std::string extension = entry.path().extension().string();
+            if (entry.is_regular_file() && (extension == ".asm" || extension == ".pre"))
+                found.insert(entry.path().string());
+        }
+        for (const auto &file : found)
+        {
+            if (Utils::replaceExtension(file, ".pre") == file && found.count(Utils::replaceExtension(file, ".asm")))
+                continue;
+            files.push_back(file);
+        }
+    }
+    return files;
+}
+
+// Cada arquivo é montado com seu próprio pré-processador, montador e buffers;
+// as threads só compartilham o índice do próximo arquivo
+std::vector<BatchResult> BatchDriver::run(const std::vector<std::string> &inputFiles)
+{
+    std::vector<BatchResult> results(inputFiles.size());
+    for (size_t i = 0; i < inputFiles.size(); ++i)
+        results[i].inputFile = inputFiles[i];
+
+    std::atomic<size_t> next(0);
+    auto worker = [&results, &next]()
+    {
+        size_t index;
+        while ((index = next++) < results.size())
+            assembleFile(results[index]);
+    };
+
+    std::vector<std::thread> pool;
+    unsigned count = std::min<size_t>(threads, inputFiles.size());
+    for (unsigned i = 0; i < count; ++i)
+        pool.emplace_back(worker);
+    for (auto &thread : pool)
+        thread.join();
+
+    return results;
+}
+
+void BatchDriver::assembleFile(BatchResult &result)
+{
+    auto start = std::chrono::steady_clock::now();
+    try
+    {
+        std::ifstream input(result.inputFile);
+        if (!input)
+            throw std::runtime_error("Error: Could not open input file: " + result.inputFile);
+
+        std::stringstream source;
+        if (Utils::replaceExtension(result.inputFile, ".asm") == result.inputFile)
+        {
+            Preprocessor preprocessor;
+            preprocessor.setIncludeDirectory(std::filesystem::path(result.inputFile).parent_path().string());
+            preprocessor.preprocess(input, source);
+        }
+        else
+        {
+            source << input.rdbuf();
+        }
+
+        std::ostringstream object;
+        Assembler assembler;
+        assembler.assemble(source, object);
+        result.objectCode = object.str();
+
+        result.objectFile = Utils::replaceExtension(result.inputFile, ".obj");
+        std::ofstream output(result.objectFile);
+        if (!output)
+            throw std::runtime_error("Error: Could not open output file: " + result.objectFile);
+        output << result.objectCode;
+    }
+    catch (const std::exception &e)
+    {
+        result.error = e.what();
+    }
+    result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void BatchDriver::printSummary(const std::vector<BatchResult> &results, double wallMilliseconds, std::ostream &output)
+{
+    double total = 0;
+    int failed = 0;
+    output << std::fixed << std::setprecision(3);
+    for (const auto &result : results)
+    {
+        output << std::setw(10) << result.milliseconds << " ms  " << result.inputFile;
+        if (!result.error.empty())
+        {
+            output << "  FAILED: " << result.error;
+            failed++;
+        }
+        output << std::endl;
+        total += result.milliseconds;
+    }
+    output << results.size() << " files, " << failed << " failed, " << total << " ms of work in "
+           << wallMilliseconds << " ms wall time" << std::endl;
+}
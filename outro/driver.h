@@ -0,0 +1,31 @@
+#ifndef DRIVER_H
+#define DRIVER_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+struct BatchResult
+{
+    std::string inputFile;
+    std::string objectFile;
+    std::string objectCode;
+    std::string error;
+    double milliseconds = 0;
+};
+
+class BatchDriver
+{
+public:
+    explicit BatchDriver(unsigned threads);
+    std::vector<BatchResult> run(const std::vector<std::string> &inputFiles);
+    static std::vector<std::string> collectInputs(const std::vector<std::string> &paths);
+    static void printSummary(const std::vector<BatchResult> &results, double wallMilliseconds, std::ostream &output);
+
+private:
+    static void assembleFile(BatchResult &result);
+
+    unsigned threads;
+};
+
+#endif // DRIVER_H
@@ -0,0 +1,269 @@
+#include "executable.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    const char magic[4] = {'M', 'E', 'X', 'E'};
+
+    uint32_t align4(uint32_t bytes)
+    {
+        return (bytes + 3) & ~3u;
+    }
+
+    bool inside(uint32_t offset, uint64_t bytes, size_t length)
+    {
+        return offset % 4 == 0 && offset + bytes <= length;
+    }
+
+    // Confere o cabeçalho antes de qualquer acesso: segmentos e tabelas dentro do arquivo
+    const ExecutableHeader &validate(const char *data, size_t length, const std::string &name)
+    {
+        if (length < sizeof(ExecutableHeader) || std::memcmp(data, magic, sizeof(magic)) != 0)
+            throw std::runtime_error("Error: Not a binary executable: " + name);
+        const ExecutableHeader &header = *reinterpret_cast<const ExecutableHeader *>(data);
+        if (header.version != Executable::version)
+            throw std::runtime_error("Error: Unsupported executable version " + std::to_string(header.version) + ": " + name);
+        uint64_t words = uint64_t(header.textWords) + header.dataWords;
+        if (header.dataOffset != header.textOffset + 4 * uint64_t(header.textWords) || !inside(header.textOffset, 4 * words, length) ||
+            (header.relocationBytes > 0 && (header.relocationBytes < (words + 7) / 8 || !inside(header.relocationOffset, header.relocationBytes, length))) ||
+            !inside(header.symbolOffset, 12 * uint64_t(header.symbolCount), length) || !inside(header.stringOffset, header.stringBytes, length) ||
+            header.entry < 0 || (words > 0 && uint64_t(header.entry) >= words))
+            throw std::runtime_error("Error: Corrupt executable header: " + name);
+        return header;
+    }
+
+    ExecutableImage decode(const char *data, size_t length, const std::string &name)
+    {
+        const ExecutableHeader &header = validate(data, length, name);
+        ExecutableImage image;
+        size_t words = size_t(header.textWords) + header.dataWords;
+        image.code.resize(words);
+        std::memcpy(image.code.data(), data + header.textOffset, words * sizeof(int32_t));
+        image.entry = header.entry;
+        image.textSize = header.dataWords == 0 ? -1 : static_cast<int>(header.textWords);
+        if (header.relocationBytes > 0)
+        {
+            const unsigned char *bits = reinterpret_cast<const unsigned char *>(data + header.relocationOffset);
+            image.relocation.resize(words);
+            for (size_t i = 0; i < words; ++i)
+                image.relocation[i] = bits[i / 8] >> (i % 8) & 1 ? '1' : '0';
+        }
+        for (uint32_t i = 0; i < header.symbolCount; ++i)
+        {
+            uint32_t entry[3];
+            std::memcpy(entry, data + header.symbolOffset + 12 * i, sizeof(entry));
+            if (uint64_t(entry[1]) + entry[2] > header.stringBytes)
+                throw std::runtime_error("Error: Corrupt symbol table: " + name);
+            image.symbols.push_back({std::string(data + header.stringOffset + entry[1], entry[2]), static_cast<int>(entry[0])});
+        }
+        return image;
+    }
+
+    // Texto: palavras decimais e, opcionalmente, a DEFINITION TABLE (uma linha "nome endereço" por símbolo)
+    ExecutableImage decodeText(std::istream &input)
+    {
+        ExecutableImage image;
+        int value;
+        while (input >> value)
+            image.code.push_back(value);
+        input.clear();
+        std::string line;
+        bool definitions = false;
+        while (std::getline(input, line))
+        {
+            std::istringstream fields(line);
+            std::string name;
+            int address;
+            if (line == "DEFINITION TABLE:")
+                definitions = true;
+            else if (definitions && fields >> name >> address)
+                image.symbols.push_back({name, address});
+        }
+        return image;
+    }
+}
+
+void Executable::write(const ExecutableImage &image, std::ostream &output)
+{
+    uint32_t words = static_cast<uint32_t>(image.code.size());
+    uint32_t textWords = image.textSize < 0 ? words : static_cast<uint32_t>(image.textSize);
+    std::string strings;
+    for (const auto &[name, address] : image.symbols)
+        strings += name;
+
+    ExecutableHeader header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.entry = image.entry;
+    header.textOffset = sizeof(ExecutableHeader);
+    header.textWords = textWords;
+    header.dataOffset = header.textOffset + 4 * textWords;
+    header.dataWords = words - textWords;
+    header.relocationOffset = header.dataOffset + 4 * header.dataWords;
+    header.relocationBytes = image.relocation.empty() ? 0 : align4((words + 7) / 8);
+    header.symbolOffset = header.relocationOffset + header.relocationBytes;
+    header.symbolCount = static_cast<uint32_t>(image.symbols.size());
+    header.stringOffset = header.symbolOffset + 12 * header.symbolCount;
+    header.stringBytes = static_cast<uint32_t>(strings.size());
+
+    output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    output.write(reinterpret_cast<const char *>(image.code.data()), static_cast<std::streamsize>(words * sizeof(int32_t)));
+    if (header.relocationBytes > 0)
+    {
+        std::string bits = packRelocation(image.relocation, words);
+        bits.resize(header.relocationBytes, '\0');
+        output.write(bits.data(), static_cast<std::streamsize>(bits.size()));
+    }
+    uint32_t nameOffset = 0;
+    for (const auto &[name, address] : image.symbols)
+    {
+        uint32_t entry[3] = {static_cast<uint32_t>(address), nameOffset, static_cast<uint32_t>(name.size())};
+        output.write(reinterpret_cast<const char *>(entry), sizeof(entry));
+        nameOffset += entry[2];
+    }
+    output.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+}
+
+void Executable::write(const ExecutableImage &image, const std::string &file)
+{
+    std::ofstream output(file, std::ios::binary);
+    if (!output)
+        throw std::runtime_error("Error: Could not open output file: " + file);
+    write(image, output);
+}
+
+void Executable::writeText(const ExecutableImage &image, std::ostream &output)
+{
+    for (int word : image.code)
+        output << word << " ";
+    output << "\nDEFINITION TABLE:\n";
+    for (const auto &[name, address] : image.symbols)
+        output << name << " " << address << "\n";
+}
+
+std::string Executable::packRelocation(const std::string &relocation, size_t words)
+{
+    std::string bits((words + 7) / 8, '\0');
+    for (size_t i = 0; i < relocation.size() && i < words; ++i)
+    {
+        if (relocation[i] == '1')
+            bits[i / 8] = static_cast<char>(bits[i / 8] | 1 << (i % 8));
+    }
+    return bits;
+}
+
+bool Executable::isBinary(std::istream &input)
+{
+    char start[sizeof(magic)] = {};
+    std::streampos position = input.tellg();
+    input.read(start, sizeof(start));
+    bool binary = input.gcount() == sizeof(start) && std::memcmp(start, magic, sizeof(magic)) == 0;
+    input.clear();
+    input.seekg(position);
+    return binary;
+}
+
+bool Executable::isBinary(const std::string &file)
+{
+    std::ifstream input(file, std::ios::binary);
+    return input && isBinary(input);
+}
+
+ExecutableImage Executable::read(std::istream &input)
+{
+    if (!isBinary(input))
+        return decodeText(input);
+    std::string data(std::istreambuf_iterator<char>(input), {});
+    return decode(data.data(), data.size(), "stream");
+}
+
+ExecutableImage Executable::read(const std::string &file)
+{
+    std::ifstream input(file, std::ios::binary);
+    if (!input)
+        throw std::runtime_error("Error: Could not open executable: " + file);
+    if (!isBinary(input))
+        return decodeText(input);
+    std::string data(std::istreambuf_iterator<char>(input), {});
+    return decode(data.data(), data.size(), file);
+}
+
+MappedExecutable::MappedExecutable(const std::string &file)
+{
+    int descriptor = ::open(file.c_str(), O_RDONLY);
+    if (descriptor < 0)
+        throw std::runtime_error("Error: Could not open executable: " + file);
+    struct stat status{};
+    if (::fstat(descriptor, &status) != 0 || status.st_size == 0)
+    {
+        ::close(descriptor);
+        throw std::runtime_error("Error: Not a binary executable: " + file);
+    }
+    length = static_cast<size_t>(status.st_size);
+    base = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, descriptor, 0);
+    ::close(descriptor);
+    if (base == MAP_FAILED)
+    {
+        base = nullptr;
+        throw std::runtime_error("Error: Could not map executable: " + file);
+    }
+    try
+    {
+        validate(static_cast<const char *>(base), length, file);
+    }
+    catch (...)
+    {
+        ::munmap(base, length);
+        throw;
+    }
+}
+
+MappedExecutable::~MappedExecutable()
+{
+    if (base != nullptr)
+        ::munmap(base, length);
+}
+
+const ExecutableHeader &MappedExecutable::header() const
+{
+    return *static_cast<const ExecutableHeader *>(base);
+}
+
+int *MappedExecutable::memory()
+{
+    return reinterpret_cast<int *>(static_cast<char *>(base) + header().textOffset);
+}
+
+const int *MappedExecutable::memory() const
+{
+    return reinterpret_cast<const int *>(static_cast<const char *>(base) + header().textOffset);
+}
+
+size_t MappedExecutable::words() const
+{
+    return size_t(header().textWords) + header().dataWords;
+}
+
+bool MappedExecutable::isRelocatable(int address) const
+{
+    const unsigned char *bits = relocationBitmap();
+    if (bits == nullptr || address < 0 || static_cast<size_t>(address) >= words())
+        return false;
+    return bits[address / 8] >> (address % 8) & 1;
+}
+
+const unsigned char *MappedExecutable::relocationBitmap() const
+{
+    if (header().relocationBytes == 0)
+        return nullptr;
+    return static_cast<const unsigned char *>(base) + header().relocationOffset;
+}
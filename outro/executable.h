@@ -0,0 +1,88 @@
+#ifndef EXECUTABLE_H
+#define EXECUTABLE_H
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Executável binário (.e): cabeçalho de 64 bytes e, em seguida, os segmentos TEXT e DATA
+// contíguos, como palavras int32 little-endian, para que o arquivo mapeado já seja a memória
+// do programa. Depois vêm, opcionais, o mapa de relocação (1 bit por palavra, o bit menos
+// significativo primeiro) e a tabela de símbolos com os nomes numa tabela de strings.
+// Todos os deslocamentos são em bytes desde o início do arquivo e múltiplos de 4.
+struct ExecutableHeader
+{
+    char magic[4];
+    uint32_t version;
+    int32_t entry;
+    uint32_t textOffset;
+    uint32_t textWords;
+    uint32_t dataOffset; // Sempre textOffset + 4 * textWords
+    uint32_t dataWords;
+    uint32_t relocationOffset;
+    uint32_t relocationBytes; // 0 sem mapa de relocação
+    uint32_t symbolOffset;
+    uint32_t symbolCount; // Entradas {endereço, início do nome, tamanho do nome}
+    uint32_t stringOffset;
+    uint32_t stringBytes;
+    uint32_t reserved[3];
+};
+
+static_assert(sizeof(ExecutableHeader) == 64, "ExecutableHeader must stay 64 bytes");
+
+// Conteúdo de um executável, binário ou de texto
+struct ExecutableImage
+{
+    std::vector<int> code;
+    int entry = 0;
+    int textSize = -1;      // Palavras de TEXT; -1 quando tudo é TEXT
+    std::string relocation; // '1' nas palavras com endereço; vazio quando não há mapa
+    std::vector<std::pair<std::string, int>> symbols;
+};
+
+class Executable
+{
+public:
+    static const uint32_t version = 1;
+
+    static void write(const ExecutableImage &image, std::ostream &output);
+    static void write(const ExecutableImage &image, const std::string &file);
+    // Formato de texto, para leitura humana: as palavras numa linha e a DEFINITION TABLE
+    static void writeText(const ExecutableImage &image, std::ostream &output);
+
+    static bool isBinary(std::istream &input);
+    static bool isBinary(const std::string &file);
+    // Lê qualquer um dos dois formatos
+    static ExecutableImage read(std::istream &input);
+    static ExecutableImage read(const std::string &file);
+
+    // Mapa de relocação '0'/'1' no formato do arquivo: 1 bit por palavra, o menos significativo primeiro
+    static std::string packRelocation(const std::string &relocation, size_t words);
+};
+
+// Executável binário mapeado com MAP_PRIVATE: memory() aponta direto para o TEXT+DATA do
+// arquivo, sem leitura nem conversão; escritas do programa ficam só neste processo
+class MappedExecutable
+{
+public:
+    explicit MappedExecutable(const std::string &file);
+    ~MappedExecutable();
+    MappedExecutable(const MappedExecutable &) = delete;
+    MappedExecutable &operator=(const MappedExecutable &) = delete;
+
+    const ExecutableHeader &header() const;
+    int *memory();
+    const int *memory() const;
+    size_t words() const;
+    bool isRelocatable(int address) const; // Sempre false sem mapa de relocação
+    const unsigned char *relocationBitmap() const; // nullptr sem mapa de relocação
+
+private:
+    void *base = nullptr;
+    size_t length = 0;
+};
+
+#endif // EXECUTABLE_H
@@ -0,0 +1,200 @@
+#include "expression.h"
+#include <cctype>
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+
+Expression::Expression(const std::string &text, const Resolver &resolve)
+    : text(text), resolve(resolve)
+{
+}
+
+long long Expression::evaluate(const std::string &text, const Resolver &resolve)
+{
+    Expression parser(text, resolve);
+    long long value = parser.logicalOr();
+    parser.skipSpaces();
+    if (parser.position != text.size())
+        throw std::runtime_error("Error: Invalid expression: " + text);
+    return value;
+}
+
+void Expression::skipSpaces()
+{
+    while (position < text.size() && std::isspace(static_cast<unsigned char>(text[position])))
+        ++position;
+}
+
+// Estouro no lado não avaliado de && ou || não é erro, como a divisão por zero
+long long Expression::checked(bool overflow, long long value)
+{
+    if (overflow && skipping == 0)
+        throw std::runtime_error("Error: Overflow in expression: " + text);
+    return value;
+}
+
+bool Expression::accept(const char *symbol)
+{
+    skipSpaces();
+    size_t length = std::strlen(symbol);
+    if (text.compare(position, length, symbol) != 0)
+        return false;
+    // '<' não pode consumir o início de '<=', nem '!' o de '!='
+    if (length == 1 && position + 1 < text.size() && text[position + 1] == '=' && std::strchr("<>!=", symbol[0]))
+        return false;
+    position += length;
+    return true;
+}
+
+long long Expression::logicalOr()
+{
+    long long value = logicalAnd();
+    while (accept("||"))
+    {
+        // Curto-circuito: o lado direito é analisado, mas seus nomes não são resolvidos
+        skipping += value != 0;
+        long long right = logicalAnd();
+        skipping -= value != 0;
+        value = value || right;
+    }
+    return value;
+}
+
+long long Expression::logicalAnd()
+{
+    long long value = equality();
+    while (accept("&&"))
+    {
+        skipping += value == 0;
+        long long right = equality();
+        skipping -= value == 0;
+        value = value && right;
+    }
+    return value;
+}
+
+long long Expression::equality()
+{
+    long long value = relational();
+    while (true)
+    {
+        if (accept("=="))
+            value = value == relational();
+        else if (accept("!="))
+            value = value != relational();
+        else
+            return value;
+    }
+}
+
+long long Expression::relational()
+{
+    long long value = additive();
+    while (true)
+    {
+        if (accept("<="))
+            value = value <= additive();
+        else if (accept(">="))
+            value = value >= additive();
+        else if (accept("<"))
+            value = value < additive();
+        else if (accept(">"))
+            value = value > additive();
+        else
+            return value;
+    }
+}
+
+long long Expression::additive()
+{
+    long long value = multiplicative();
+    while (true)
+    {
+        bool add = accept("+");
+        if (!add && !accept("-"))
+            return value;
+        long long right = multiplicative();
+        bool overflow = add ? __builtin_add_overflow(value, right, &value) : __builtin_sub_overflow(value, right, &value);
+        value = checked(overflow, value);
+    }
+}
+
+long long Expression::multiplicative()
+{
+    long long value = unary();
+    while (true)
+    {
+        if (accept("*"))
+        {
+            long long right = unary();
+            bool overflow = __builtin_mul_overflow(value, right, &value);
+            value = checked(overflow, value);
+            continue;
+        }
+        bool divide = accept("/");
+        if (!divide && !accept("%"))
+            return value;
+
+        long long right = unary();
+        if (right == 0 && skipping > 0)
+            right = 1;
+        if (right == 0)
+            throw std::runtime_error("Error: Division by zero in expression: " + text);
+        if (value == LLONG_MIN && right == -1)
+            value = checked(true, divide ? LLONG_MIN : 0); // O quociente não cabe em long long
+        else
+            value = divide ? value / right : value % right;
+    }
+}
+
+long long Expression::unary()
+{
+    if (accept("-"))
+    {
+        long long value = unary();
+        return checked(value == LLONG_MIN, value == LLONG_MIN ? value : -value);
+    }
+    if (accept("+"))
+        return unary();
+    if (accept("!"))
+        return !unary();
+    return primary();
+}
+
+long long Expression::primary()
+{
+    skipSpaces();
+    if (accept("("))
+    {
+        long long value = logicalOr();
+        if (!accept(")"))
+            throw std::runtime_error("Error: Missing ')' in expression: " + text);
+        return value;
+    }
+
+    size_t start = position;
+    if (position < text.size() && std::isdigit(static_cast<unsigned char>(text[position])))
+    {
+        while (position < text.size() && std::isalnum(static_cast<unsigned char>(text[position])))
+            ++position;
+        std::string number = text.substr(start, position - start);
+        // Decimal, como os EQUs sempre foram; hexadecimal só com 0x explícito
+        bool hexadecimal = number.size() > 2 && number[0] == '0' && (number[1] == 'x' || number[1] == 'X');
+        const char *first = number.data() + (hexadecimal ? 2 : 0);
+        const char *last = number.data() + number.size();
+        long long value = 0;
+        auto [end, error] = std::from_chars(first, last, value, hexadecimal ? 16 : 10);
+        if (error == std::errc::result_out_of_range)
+            throw std::runtime_error("Error: Number out of range in expression: " + number);
+        if (error != std::errc() || end != last)
+            throw std::runtime_error("Error: Invalid number in expression: " + number);
+        return value;
+    }
+
+    while (position < text.size() && (std::isalnum(static_cast<unsigned char>(text[position])) || text[position] == '_'))
+        ++position;
+    if (position == start)
+        throw std::runtime_error("Error: Invalid expression: " + text);
+    return skipping > 0 ? 0 : resolve(text.substr(start, position - start));
+}
@@ -0,0 +1,36 @@
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+
+#include <functional>
+#include <string>
+
+// Expressões constantes inteiras de EQU e IF:
+//   || && == != < <= > >= + - * / % ! e - unários, parênteses,
+//   números decimais ou 0x hexadecimais e nomes resolvidos por 'resolve'; estouro é erro
+class Expression
+{
+public:
+    using Resolver = std::function<long long(const std::string &name)>;
+    static long long evaluate(const std::string &text, const Resolver &resolve);
+
+private:
+    Expression(const std::string &text, const Resolver &resolve);
+    long long logicalOr();
+    long long logicalAnd();
+    long long equality();
+    long long relational();
+    long long additive();
+    long long multiplicative();
+    long long unary();
+    long long primary();
+    long long checked(bool overflow, long long value);
+    void skipSpaces();
+    bool accept(const char *symbol);
+
+    const std::string &text;
+    const Resolver &resolve;
+    size_t position = 0;
+    int skipping = 0; // > 0 dentro do lado não avaliado de && ou ||
+};
+
+#endif // EXPRESSION_H
@@ -0,0 +1,145 @@
+#include "generator.h"
+#include <algorithm>
+#include <sstream>
+
+ProgramGenerator::ProgramGenerator(const GeneratorOptions &options)
+    : options(options), state(options.seed)
+{
+    this->options.modules = std::max<size_t>(1, options.modules);
+}
+
+// splitmix64: a mesma sequência em qualquer compilador, ao contrário das distribuições da std
+size_t ProgramGenerator::random(size_t bound)
+{
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z ^= z >> 31;
+    return bound == 0 ? 0 : static_cast<size_t>(z % bound);
+}
+
+bool ProgramGenerator::chance(double probability)
+{
+    return static_cast<double>(random(1000000)) < probability * 1000000;
+}
+
+std::vector<std::string> ProgramGenerator::generate()
+{
+    std::vector<std::string> sources;
+    for (size_t module = 0; module < options.modules; ++module)
+    {
+        size_t lines = options.lines / options.modules + (module < options.lines % options.modules ? 1 : 0);
+        sources.push_back(generateModule(module, lines));
+    }
+    return sources;
+}
+
+// Cabeçalho de ligação e EQUs, corpo com blocos de dados em SECTION DATA a cada poucas
+// instruções e um final que desvia para o módulo seguinte ou para
+std::string ProgramGenerator::generateModule(size_t module, size_t budget)
+{
+    const size_t codePerBlock = 24;
+    const size_t dataPerBlock = 4;
+
+    std::ostringstream out;
+    size_t emitted = 0;
+    auto emit = [&](const std::string &line)
+    {
+        out << line << '\n';
+        ++emitted;
+    };
+
+    std::string id = std::to_string(module);
+    bool linked = options.modules > 1;
+    std::string nextModule = std::to_string(module + 1);
+    std::string sharedData = "P" + std::to_string((module + 1) % options.modules);
+    if (linked)
+    {
+        emit("MOD" + id + ": BEGIN");
+        if (module + 1 < options.modules)
+            emit("MOD" + nextModule + ": EXTERN");
+        emit(sharedData + ": EXTERN");
+        emit("PUBLIC P" + id);
+    }
+
+    size_t equs = options.equCount / options.modules + (module < options.equCount % options.modules ? 1 : 0);
+    for (size_t k = 0; k < equs; ++k)
+        emit("Q" + id + "_" + std::to_string(k) + ": EQU (" + std::to_string(k) + " * 7 + 1) % 3");
+
+    size_t body = budget > emitted + 8 ? budget - emitted - 8 : 0;
+    size_t blocks = body / (codePerBlock + dataPerBlock + 2) + 1;
+    size_t dataCount = blocks * dataPerBlock;
+    size_t defined = 0;
+    auto dataName = [&id](size_t k)
+    { return "D" + id + "_" + std::to_string(k); };
+    auto emitDataBlock = [&]()
+    {
+        emit("SECTION DATA");
+        for (size_t k = 0; k < dataPerBlock && defined < dataCount; ++k)
+            emit(dataName(defined++) + ": SPACE 2");
+        emit("SECTION TEXT");
+    };
+
+    auto operand = [&]()
+    {
+        if (linked && chance(0.02))
+            return sharedData;
+        bool forward = defined < dataCount && (defined == 0 || chance(options.forwardRatio));
+        size_t k = forward ? defined + random(dataCount - defined) : random(defined);
+        std::string name = dataName(k);
+        return chance(options.expressionRatio) ? name + " + 1" : name;
+    };
+
+    static const char *const operations[] = {"LOAD", "ADD", "SUB", "STORE", "LOAD", "ADD"};
+    size_t labels = 0, equsUsed = 0, sinceBlock = 0;
+    std::string pendingTarget; // Rótulo já usado por um JMP, a ser definido na próxima instrução
+    emit("SECTION TEXT");
+    while (emitted + 8 < budget)
+    {
+        if (sinceBlock >= codePerBlock && defined < dataCount)
+        {
+            emitDataBlock();
+            sinceBlock = 0;
+        }
+        ++sinceBlock;
+
+        std::string label = pendingTarget;
+        pendingTarget.clear();
+        if (label.empty() && chance(options.labelDensity))
+            label = "L" + id + "_" + std::to_string(labels++);
+        std::string prefix = label.empty() ? "" : label + ": ";
+
+        size_t kind = random(100);
+        if (kind < 4)
+        {
+            pendingTarget = "L" + id + "_" + std::to_string(labels++);
+            emit(prefix + "JMP " + pendingTarget);
+        }
+        else if (kind < 8 && label.empty() && equsUsed < equs)
+        {
+            emit("IF Q" + id + "_" + std::to_string(equsUsed++));
+            emit("ADD " + operand());
+        }
+        else if (kind < 14)
+        {
+            emit(prefix + "COPY " + operand() + "," + operand());
+        }
+        else
+        {
+            emit(prefix + operations[random(6)] + " " + operand());
+        }
+    }
+
+    std::string prefix = pendingTarget.empty() ? "" : pendingTarget + ": ";
+    emit(prefix + "OUTPUT " + dataName(0));
+    emit(linked && module + 1 < options.modules ? "JMP MOD" + nextModule : "STOP");
+    while (defined < dataCount)
+        emitDataBlock();
+    if (linked)
+    {
+        emit("SECTION DATA");
+        emit("P" + id + ": SPACE 2");
+        emit("END");
+    }
+    return out.str();
+}
@@ -0,0 +1,36 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct GeneratorOptions
+{
+    size_t lines = 1000;          // Total de linhas, somando todos os módulos
+    double labelDensity = 0.2;    // Fração das instruções com rótulo
+    double forwardRatio = 0.5;    // Fração das referências a dados definidos mais adiante
+    size_t equCount = 16;         // Constantes EQU, cada uma testada por um IF
+    double expressionRatio = 0.1; // Fração dos operandos na forma SIMBOLO + N
+    size_t modules = 1;           // Módulos ligados por EXTERN/PUBLIC
+    uint32_t seed = 1;
+};
+
+// Gera programas válidos para o montador, determinísticos para as mesmas opções. Todo desvio
+// é para frente e o último módulo termina em STOP, então o programa sempre para no simulador.
+class ProgramGenerator
+{
+public:
+    explicit ProgramGenerator(const GeneratorOptions &options);
+    std::vector<std::string> generate(); // Um fonte (antes do pré-processamento) por módulo
+
+private:
+    std::string generateModule(size_t module, size_t lines);
+    size_t random(size_t bound);
+    bool chance(double probability);
+
+    GeneratorOptions options;
+    uint64_t state;
+};
+
+#endif // GENERATOR_H
@@ -0,0 +1,58 @@
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include "generator.h"
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " lines prefix [-m modules] [-l labels] [-f forward] [-q equs] [-x expressions] [-s seed]" << std::endl;
+        std::cerr << "Writes prefix.asm, or prefix_0.asm ... prefix_N.asm with -m" << std::endl;
+        return 1;
+    }
+
+    GeneratorOptions options;
+    std::string prefix = argv[2];
+    try
+    {
+        options.lines = std::stoul(argv[1]);
+        for (int i = 3; i + 1 < argc; i += 2)
+        {
+            std::string arg = argv[i];
+            std::string value = argv[i + 1];
+            if (arg == "-m")
+                options.modules = std::stoul(value);
+            else if (arg == "-l")
+                options.labelDensity = std::stod(value);
+            else if (arg == "-f")
+                options.forwardRatio = std::stod(value);
+            else if (arg == "-q")
+                options.equCount = std::stoul(value);
+            else if (arg == "-x")
+                options.expressionRatio = std::stod(value);
+            else if (arg == "-s")
+                options.seed = std::stoul(value);
+            else
+                throw std::runtime_error("Unknown option: " + arg);
+        }
+
+        std::vector<std::string> sources = ProgramGenerator(options).generate();
+        for (size_t i = 0; i < sources.size(); ++i)
+        {
+            std::string file = sources.size() == 1 ? prefix + ".asm" : prefix + "_" + std::to_string(i) + ".asm";
+            std::ofstream output(file);
+            if (!output)
+                throw std::runtime_error("Error: Could not open output file: " + file);
+            output << sources[i];
+            std::cout << "Generated " << file << std::endl;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
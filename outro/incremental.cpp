@@ -0,0 +1,463 @@
+#include "incremental.h"
+#include <algorithm>
+#include <cstdlib>
+#include <unordered_set>
+
+ObjectCode IncrementalAssembler::assemble(const std::vector<std::string> &newLines)
+{
+    stats = {};
+    if (!valid)
+        return rebuild(newLines);
+
+    // Linhas iguais no início e no fim delimitam a região editada
+    size_t common = std::min(lines.size(), newLines.size());
+    size_t prefix = 0;
+    while (prefix < common && lines[prefix] == newLines[prefix])
+        ++prefix;
+    size_t suffix = 0;
+    while (suffix < common - prefix && lines[lines.size() - 1 - suffix] == newLines[newLines.size() - 1 - suffix])
+        ++suffix;
+    size_t oldEnd = lines.size() - suffix;
+    size_t newEnd = newLines.size() - suffix;
+    if (prefix == oldEnd && prefix == newEnd)
+        return object;
+
+    // A região é analisada a partir da seção em vigor antes dela; se termina em outra seção
+    // que antes, as linhas seguintes mudariam de seção e a montagem é refeita
+    Section before = prefix > 0 ? passes[prefix - 1].section : TextSection;
+    Section oldAfter = oldEnd > prefix ? passes[oldEnd - 1].section : before;
+    std::vector<FirstPassResult> changed;
+    if (!relex(newLines, prefix, newEnd, before, changed))
+        return rebuild(newLines);
+    if ((changed.empty() ? before : changed.back().section) != oldAfter)
+        return rebuild(newLines);
+
+    int oldWords[SectionCount] = {}, newWords[SectionCount] = {};
+    for (size_t i = prefix; i < oldEnd; ++i)
+        oldWords[passes[i].section] += lineWords(passes[i]).size();
+    for (const auto &pass : changed)
+        newWords[pass.section] += lineWords(pass).size();
+    bool sameSize = std::equal(oldWords, oldWords + SectionCount, newWords);
+    stats.patchedInPlace = sameSize;
+
+    // As linhas depois da região mudam de número, não de conteúdo
+    long shift = static_cast<long>(newEnd) - static_cast<long>(oldEnd);
+    for (size_t i = oldEnd; i < passes.size() && shift != 0; ++i)
+    {
+        for (auto &symbol : passes[i].symbols)
+            symbol.line += shift;
+        for (auto &reference : passes[i].references)
+            reference.line += shift;
+        for (auto &diagnostic : passes[i].diagnostics)
+            diagnostic.line += shift;
+    }
+    passes.erase(passes.begin() + prefix, passes.begin() + oldEnd);
+    passes.insert(passes.begin() + prefix, std::make_move_iterator(changed.begin()), std::make_move_iterator(changed.end()));
+    lines = newLines;
+    std::vector<int> oldAddresses = std::move(addresses);
+    size_t total = computeAddresses();
+
+    std::unordered_map<std::string, SymbolInfo> newTable;
+    if (!buildSymbolTable(newTable))
+        return rebuild(newLines);
+
+    // Símbolos novos, removidos ou com outro endereço invalidam todas as linhas que os usam
+    std::unordered_set<std::string> changedSymbols;
+    for (const auto &[name, info] : newTable)
+    {
+        auto it = symbolTable.find(name);
+        if (it == symbolTable.end() || it->second.address != info.address || it->second.isExtern != info.isExtern)
+            changedSymbols.insert(name);
+    }
+    for (const auto &[name, info] : symbolTable)
+    {
+        if (newTable.find(name) == newTable.end())
+            changedSymbols.insert(name);
+    }
+    symbolTable = std::move(newTable);
+
+    // A região, as linhas que mudaram de endereço (com tamanho igual, nenhuma) e quem usa
+    // os símbolos alterados
+    std::vector<char> affected(passes.size(), 0);
+    for (size_t i = 0; i < passes.size(); ++i)
+    {
+        if (i >= prefix && i < newEnd)
+            affected[i] = 1;
+        else
+            affected[i] = addresses[i] != oldAddresses[i < prefix ? i : i - shift];
+        for (const auto &reference : passes[i].references)
+        {
+            if (!affected[i] && changedSymbols.count(reference.symbol))
+                affected[i] = 1;
+        }
+    }
+    stats.firstChangedAddress = static_cast<int>(object.code.size());
+    for (size_t i = 0; i < passes.size(); ++i)
+    {
+        if (!affected[i])
+            continue;
+        if (!resolve(i))
+            return rebuild(newLines);
+        stats.firstChangedAddress = std::min(stats.firstChangedAddress, addresses[i]);
+    }
+
+    // Palavras de linhas que não mudaram nem se moveram já estão no lugar
+    object.code.resize(total);
+    object.relocation.resize(total);
+    stats.firstChangedAddress = std::min<int>(stats.firstChangedAddress, total);
+    for (size_t i = 0; i < passes.size(); ++i)
+    {
+        if (affected[i])
+            placeLine(i);
+    }
+
+    if (!finishObject(newLines))
+        return rebuild(newLines);
+    return object;
+}
+
+const IncrementalStats &IncrementalAssembler::getStats() const
+{
+    return stats;
+}
+
+// Montagem completa que preenche o estado por linha; com erro, o diagnóstico é o da montagem limpa
+ObjectCode IncrementalAssembler::rebuild(const std::vector<std::string> &newLines)
+{
+    stats.fullRebuild = true;
+    stats.firstChangedAddress = 0;
+    lines = newLines;
+    passes.clear();
+    valid = false;
+
+    bool ok = relex(lines, 0, lines.size(), TextSection, passes);
+    object = {};
+    if (ok)
+    {
+        size_t total = computeAddresses();
+        object.code.resize(total);
+        object.relocation.resize(total);
+        symbolTable.clear();
+        ok = buildSymbolTable(symbolTable);
+    }
+    for (size_t i = 0; ok && i < passes.size(); ++i)
+    {
+        ok = resolve(i);
+        placeLine(i);
+    }
+    if (ok && finishObject(lines))
+    {
+        valid = true;
+        return object;
+    }
+
+    object = assembler.assembleObject(lines);
+    return object;
+}
+
+// Primeira passagem linha a linha; cada linha começa na seção em que a anterior terminou
+bool IncrementalAssembler::relex(const std::vector<std::string> &source, size_t begin, size_t end, Section section, std::vector<FirstPassResult> &result)
+{
+    std::ostream silent(nullptr);
+    result.reserve(result.size() + end - begin);
+    for (size_t i = begin; i < end; ++i)
+    {
+        result.emplace_back();
+        result.back().section = i > begin ? result[result.size() - 2].section : section;
+        try
+        {
+            assembler.firstPass(source, i, i + 1, result.back(), silent);
+        }
+        catch (const std::exception &)
+        {
+            return false;
+        }
+    }
+    stats.linesRelexed += end - begin;
+    return true;
+}
+
+// Segunda passagem de uma linha no seu endereço atual
+bool IncrementalAssembler::resolve(size_t index)
+{
+    std::ostream silent(nullptr);
+    FirstPassResult &pass = passes[index];
+    pass.usages.clear();
+    pass.diagnostics.clear();
+    for (const auto &reference : pass.references)
+        pass.words[reference.section][reference.position] = 0; // Referência não resolvida fica 00, como na montagem limpa
+    SectionBases bases;
+    bases.fill(addresses[index]);
+    assembler.secondPass(pass, bases, symbolTable, silent);
+    stats.linesResolved++;
+    for (const auto &diagnostic : pass.diagnostics)
+    {
+        if (diagnostic.isError)
+            return false;
+    }
+    return true;
+}
+
+// As palavras de uma linha ficam todas na seção em que ela termina: uma troca de seção
+// é processada antes do rótulo e não gera palavras
+const std::vector<int> &IncrementalAssembler::lineWords(const FirstPassResult &pass)
+{
+    return pass.words[pass.section];
+}
+
+// Endereço de cada linha com o TEXT de todas as linhas antes do DATA; devolve o total de palavras
+size_t IncrementalAssembler::computeAddresses()
+{
+    SectionBases next{};
+    for (const auto &pass : passes)
+    {
+        if (pass.section == TextSection)
+            next[DataSection] += static_cast<int>(lineWords(pass).size());
+    }
+    object.textSize = next[DataSection];
+    addresses.resize(passes.size());
+    for (size_t i = 0; i < passes.size(); ++i)
+    {
+        addresses[i] = next[passes[i].section];
+        next[passes[i].section] += static_cast<int>(lineWords(passes[i]).size());
+    }
+    return next[DataSection];
+}
+
+void IncrementalAssembler::placeLine(size_t index)
+{
+    const FirstPassResult &pass = passes[index];
+    const std::vector<int> &words = lineWords(pass);
+    std::copy(words.begin(), words.end(), object.code.begin() + addresses[index]);
+    object.relocation.replace(addresses[index], words.size(), pass.relocation[pass.section]);
+}
+
+bool IncrementalAssembler::buildSymbolTable(std::unordered_map<std::string, SymbolInfo> &table) const
+{
+    for (size_t i = 0; i < passes.size(); ++i)
+    {
+        for (const auto &definition : passes[i].symbols)
+        {
+            SymbolInfo info = definition.info;
+            if (!info.isExtern)
+                info.address += addresses[i];
+            if (!table.emplace(definition.name, info).second)
+                return false;
+        }
+    }
+    return true;
+}
+
+// Tabelas de definições e de uso e os avisos, refeitos a partir do estado de cada linha
+bool IncrementalAssembler::finishObject(const std::vector<std::string> &source)
+{
+    bool hasBegin = false, hasEnd = false;
+    object.diagnostics.clear();
+    object.definitions.clear();
+    object.usages.clear();
+    for (const auto &pass : passes)
+    {
+        hasBegin = hasBegin || pass.hasBegin;
+        hasEnd = hasEnd || pass.hasEnd;
+        object.diagnostics.insert(object.diagnostics.end(), pass.diagnostics.begin(), pass.diagnostics.end());
+    }
+    if (hasBegin != hasEnd || passes.size() != source.size())
+        return false;
+
+    std::unordered_set<std::string> defined;
+    std::unordered_map<std::string, size_t> usageIndex;
+    for (const auto &pass : passes)
+    {
+        for (const auto &symbol : pass.definitions)
+        {
+            if (!defined.insert(symbol).second)
+                continue;
+            auto it = symbolTable.find(symbol);
+            if (it == symbolTable.end() || it->second.isExtern)
+                return false;
+            object.definitions.push_back({symbol, it->second.address});
+        }
+        for (const auto &[symbol, position] : pass.usages)
+        {
+            auto it = usageIndex.find(symbol);
+            if (it == usageIndex.end())
+            {
+                it = usageIndex.emplace(symbol, object.usages.size()).first;
+                object.usages.push_back({symbol, {}});
+            }
+            object.usages[it->second].second.push_back(position);
+        }
+    }
+    return true;
+}
+
+namespace
+{
+    // Leitura dos campos de um registro do estado, separados por espaço
+    class FieldReader
+    {
+    public:
+        explicit FieldReader(const std::string &line) : position(line.c_str()), ok(true) {}
+
+        long number()
+        {
+            char *end;
+            long value = std::strtol(position, &end, 10);
+            ok = ok && end != position;
+            position = end;
+            return value;
+        }
+
+        std::string word()
+        {
+            while (*position == ' ')
+                ++position;
+            const char *start = position;
+            while (*position != ' ' && *position != '\0')
+                ++position;
+            ok = ok && position != start;
+            return std::string(start, position);
+        }
+
+        bool good() const
+        {
+            return ok;
+        }
+
+    private:
+        const char *position;
+        bool ok;
+    };
+}
+
+// Formato do estado: um cabeçalho e, para cada linha do fonte, o texto original ("L texto") e
+// um registro com palavras já resolvidas, relocação, símbolos, referências, definições, usos,
+// BEGIN/END e número de avisos, seguido dos avisos, um por linha
+void IncrementalAssembler::save(std::ostream &output) const
+{
+    if (!valid)
+        return;
+    output << "INCREMENTAL 2 " << lines.size() << "\n";
+    for (size_t i = 0; i < lines.size(); ++i)
+    {
+        const FirstPassResult &pass = passes[i];
+        const std::string &relocation = pass.relocation[pass.section];
+        output << "L " << lines[i] << "\n"
+               << pass.section << " " << lineWords(pass).size();
+        for (int word : lineWords(pass))
+            output << " " << word;
+        output << " " << (relocation.empty() ? "-" : relocation) << " " << pass.symbols.size();
+        for (const auto &symbol : pass.symbols)
+            output << " " << symbol.name << " " << symbol.info.address << " " << symbol.info.isExtern << " " << symbol.line;
+        output << " " << pass.references.size();
+        for (const auto &reference : pass.references)
+            output << " " << reference.position << " " << reference.symbol << " " << static_cast<int>(reference.op) << " " << reference.value << " " << reference.line;
+        output << " " << pass.definitions.size();
+        for (const auto &definition : pass.definitions)
+            output << " " << definition;
+        output << " " << pass.usages.size();
+        for (const auto &[symbol, position] : pass.usages)
+            output << " " << symbol << " " << position;
+        output << " " << pass.hasBegin << " " << pass.hasEnd << " " << pass.diagnostics.size() << "\n";
+        for (const auto &diagnostic : pass.diagnostics)
+            output << diagnostic.line << " " << diagnostic.isError << " " << diagnostic.message << "\n";
+    }
+}
+
+bool IncrementalAssembler::load(std::istream &input)
+{
+    valid = false;
+    std::string line;
+    std::getline(input, line);
+    FieldReader header(line);
+    if (header.word() != "INCREMENTAL" || header.number() != 2)
+        return false;
+    size_t count = header.number();
+    if (!header.good())
+        return false;
+
+    lines.assign(count, "");
+    passes.assign(count, FirstPassResult());
+    for (size_t i = 0; i < count; ++i)
+    {
+        FirstPassResult &pass = passes[i];
+        if (!std::getline(input, line) || line.compare(0, 2, "L ") != 0)
+            return false;
+        lines[i] = line.substr(2);
+
+        std::getline(input, line);
+        FieldReader fields(line);
+        long section = fields.number();
+        if (section < 0 || section >= SectionCount)
+            return false;
+        pass.section = static_cast<Section>(section);
+        std::vector<int> &words = pass.words[pass.section];
+        words.resize(fields.number());
+        for (auto &word : words)
+            word = fields.number();
+        std::string &relocation = pass.relocation[pass.section];
+        relocation = fields.word();
+        if (relocation == "-")
+            relocation.clear();
+
+        pass.symbols.resize(fields.number());
+        for (auto &symbol : pass.symbols)
+        {
+            symbol.name = fields.word();
+            symbol.info.address = fields.number();
+            symbol.info.isExtern = fields.number() != 0;
+            symbol.info.isResolved = !symbol.info.isExtern;
+            symbol.line = fields.number();
+            symbol.section = pass.section;
+        }
+        pass.references.resize(fields.number());
+        for (auto &reference : pass.references)
+        {
+            reference.position = fields.number();
+            reference.symbol = fields.word();
+            reference.op = static_cast<char>(fields.number());
+            reference.value = fields.number();
+            reference.line = fields.number();
+            reference.section = pass.section;
+        }
+        pass.definitions.resize(fields.number());
+        for (auto &definition : pass.definitions)
+            definition = fields.word();
+        pass.usages.resize(fields.number());
+        for (auto &usage : pass.usages)
+        {
+            usage.first = fields.word();
+            usage.second = fields.number();
+        }
+        pass.hasBegin = fields.number() != 0;
+        pass.hasEnd = fields.number() != 0;
+        size_t diagnostics = fields.number();
+        if (!fields.good())
+            return false;
+
+        for (size_t d = 0; d < diagnostics; ++d)
+        {
+            std::getline(input, line);
+            FieldReader diagnostic(line);
+            size_t diagnosticLine = diagnostic.number();
+            bool isError = diagnostic.number() != 0;
+            size_t messageStart = line.find(' ', line.find(' ') + 1);
+            if (!diagnostic.good() || messageStart == std::string::npos)
+                return false;
+            pass.diagnostics.push_back({diagnosticLine, line.substr(messageStart + 1), isError});
+        }
+    }
+
+    // O objeto é remontado a partir das palavras já resolvidas, sem nova análise
+    object = {};
+    size_t total = computeAddresses();
+    symbolTable.clear();
+    if (!buildSymbolTable(symbolTable))
+        return false;
+    object.code.resize(total);
+    object.relocation.resize(total);
+    for (size_t i = 0; i < passes.size(); ++i)
+        placeLine(i);
+    valid = finishObject(lines);
+    return valid;
+}
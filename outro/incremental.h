@@ -0,0 +1,50 @@
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "assembler.h"
+
+struct IncrementalStats
+{
+    size_t linesRelexed = 0;     // Linhas que passaram de novo pela primeira passagem
+    size_t linesResolved = 0;    // Linhas que passaram de novo pela segunda passagem
+    int firstChangedAddress = -1; // -1 quando nada mudou
+    bool patchedInPlace = false;  // Tamanhos iguais: palavras corrigidas sem mover o restante
+    bool fullRebuild = false;
+};
+
+// Montagem incremental: guarda o resultado de cada linha da última montagem e, na seguinte,
+// analisa de novo apenas as linhas alteradas. O objeto gerado é idêntico ao de uma montagem limpa.
+class IncrementalAssembler
+{
+public:
+    ObjectCode assemble(const std::vector<std::string> &lines);
+    void save(std::ostream &output) const;
+    bool load(std::istream &input);
+    const IncrementalStats &getStats() const;
+
+private:
+    ObjectCode rebuild(const std::vector<std::string> &lines);
+    bool relex(const std::vector<std::string> &lines, size_t begin, size_t end, Section section, std::vector<FirstPassResult> &passes);
+    bool resolve(size_t index);
+    bool buildSymbolTable(std::unordered_map<std::string, SymbolInfo> &symbolTable) const;
+    bool finishObject(const std::vector<std::string> &lines);
+    size_t computeAddresses();
+    void placeLine(size_t index);
+    static const std::vector<int> &lineWords(const FirstPassResult &pass);
+
+    Assembler assembler;
+    std::vector<std::string> lines;
+    std::vector<FirstPassResult> passes; // Uma entrada por linha, com endereços locais à linha
+    std::vector<int> addresses;          // Endereço final da primeira palavra de cada linha
+    std::unordered_map<std::string, SymbolInfo> symbolTable;
+    ObjectCode object;
+    bool valid = false;
+    IncrementalStats stats;
+};
+
+#endif // INCREMENTAL_H
@@ -0,0 +1,46 @@
+#include "isa.h"
+
+const InstructionInfo *Isa::find(const std::string &mnemonic)
+{
+    return lookup(mnemonic);
+}
+
+const InstructionInfo *Isa::find(int opcode)
+{
+    if (opcode < 1 || opcode > 14)
+        return nullptr;
+    return &instructionTable[opcode - 1];
+}
+
+// Tamanho em palavras (código + operandos), 0 para código inválido
+int Isa::size(int opcode)
+{
+    const InstructionInfo *info = find(opcode);
+    return info ? info->operands + 1 : 0;
+}
+
+bool Isa::isJump(int opcode)
+{
+    return opcode >= 5 && opcode <= 8;
+}
+
+bool Isa::isConditionalJump(int opcode)
+{
+    return opcode >= 6 && opcode <= 8;
+}
+
+// JMP e STOP não continuam na instrução seguinte
+bool Isa::endsBlock(int opcode)
+{
+    return opcode == 5 || opcode == 14;
+}
+
+bool Isa::readsMemory(int opcode)
+{
+    return (opcode >= 1 && opcode <= 4) || opcode == 9 || opcode == 10 || opcode == 13;
+}
+
+bool Isa::writesMemory(int opcode)
+{
+    return opcode == 9 || opcode == 11 || opcode == 12;
+}
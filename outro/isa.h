@@ -0,0 +1,41 @@
+#ifndef ISA_H
+#define ISA_H
+
+#include <string>
+#include <string_view>
+
+struct InstructionInfo
+{
+    const char *mnemonic;
+    int opcode;
+    int operands;
+};
+
+// Tabela de instruções: mnemônico, código e número de operandos. Fica no cabeçalho para que
+// a montagem em tempo de compilação use a mesma tabela
+inline constexpr InstructionInfo instructionTable[] = {
+    {"ADD", 1, 1}, {"SUB", 2, 1}, {"MULT", 3, 1}, {"DIV", 4, 1}, {"JMP", 5, 1}, {"JMPN", 6, 1}, {"JMPP", 7, 1}, {"JMPZ", 8, 1}, {"COPY", 9, 2}, {"LOAD", 10, 1}, {"STORE", 11, 1}, {"INPUT", 12, 1}, {"OUTPUT", 13, 1}, {"STOP", 14, 0}};
+
+class Isa
+{
+public:
+    static constexpr const InstructionInfo *lookup(std::string_view mnemonic)
+    {
+        for (const auto &info : instructionTable)
+        {
+            if (mnemonic == info.mnemonic)
+                return &info;
+        }
+        return nullptr;
+    }
+    static const InstructionInfo *find(const std::string &mnemonic);
+    static const InstructionInfo *find(int opcode);
+    static int size(int opcode);
+    static bool isJump(int opcode);
+    static bool isConditionalJump(int opcode);
+    static bool endsBlock(int opcode);
+    static bool readsMemory(int opcode);
+    static bool writesMemory(int opcode);
+};
+
+#endif // ISA_H
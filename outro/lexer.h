@@ -0,0 +1,160 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <cstddef>
+#include <string_view>
+
+// Operando separado em partes: imediato (só number), SIMBOLO (op == 0) ou SIMBOLO op N
+struct OperandText
+{
+    std::string_view symbol;
+    char op = 0;
+    std::string_view number;
+};
+
+// Análise léxica de uma linha sem alocação, usada pelo montador e pela montagem em tempo
+// de compilação (constassembler.h): as duas aceitam exatamente os mesmos rótulos e operandos
+// e calculam os mesmos valores
+class Lexer
+{
+public:
+    static constexpr std::string_view stripComment(std::string_view line)
+    {
+        return line.substr(0, line.find(';'));
+    }
+
+    static constexpr std::string_view trim(std::string_view text)
+    {
+        size_t begin = text.find_first_not_of(' ');
+        if (begin == std::string_view::npos)
+            return {};
+        return text.substr(begin, text.find_last_not_of(' ') - begin + 1);
+    }
+
+    // Próximo token a partir de position, separado por espaço, tabulação ou vírgula ("" no fim)
+    static constexpr std::string_view nextToken(std::string_view line, size_t &position)
+    {
+        while (position < line.size() && isSeparator(line[position]))
+            ++position;
+        size_t begin = position;
+        while (position < line.size() && !isSeparator(line[position]))
+            ++position;
+        return line.substr(begin, position - begin);
+    }
+
+    // [A-Za-z_][A-Za-z0-9_]*
+    static constexpr bool isLabel(std::string_view text)
+    {
+        if (text.empty() || isDigit(text[0]))
+            return false;
+        for (char ch : text)
+        {
+            if (!isDigit(ch) && ch != '_' && !(ch >= 'A' && ch <= 'Z') && !(ch >= 'a' && ch <= 'z'))
+                return false;
+        }
+        return true;
+    }
+
+    // Só dígitos decimais, como os imediatos e os operandos de SPACE
+    static constexpr bool isNumber(std::string_view text)
+    {
+        if (text.empty())
+            return false;
+        for (char ch : text)
+        {
+            if (!isDigit(ch))
+                return false;
+        }
+        return true;
+    }
+
+    // Inteiro decimal com sinal opcional, como o valor de CONST: o token inteiro e dentro de int
+    static constexpr bool parseDecimal(std::string_view text, int &value)
+    {
+        bool negative = !text.empty() && text[0] == '-';
+        if (!text.empty() && (text[0] == '-' || text[0] == '+'))
+            text.remove_prefix(1);
+        if (!isNumber(text))
+            return false;
+        long long magnitude = 0;
+        for (char ch : text)
+        {
+            magnitude = magnitude * 10 + (ch - '0');
+            if (magnitude > 2147483648LL)
+                return false;
+        }
+        if (magnitude > (negative ? 2147483648LL : 2147483647LL))
+            return false;
+        value = static_cast<int>(negative ? -magnitude : magnitude);
+        return true;
+    }
+
+    static constexpr bool splitOperand(std::string_view text, OperandText &operand)
+    {
+        text = trim(text);
+        if (text.empty())
+            return false;
+        if (isNumber(text))
+        {
+            operand.number = text;
+            return true;
+        }
+
+        size_t opPosition = text.find_first_of("+-*/", 1);
+        operand.symbol = trim(text.substr(0, opPosition));
+        if (!isLabel(operand.symbol))
+            return false; // "A B" ou "A$" não são símbolos
+        if (opPosition == std::string_view::npos)
+            return true;
+
+        operand.op = text[opPosition];
+        operand.number = trim(text.substr(opPosition + 1));
+        return isNumber(operand.number);
+    }
+
+    // Valor de SIMBOLO op N com o endereço do símbolo; falso em divisão inexata ou operador inválido
+    static constexpr bool applyOperator(int address, char op, int number, int &value)
+    {
+        switch (op)
+        {
+        case 0:
+            value = address;
+            return true;
+        case '+':
+            value = address + number;
+            return true;
+        case '-':
+            value = address - number;
+            return true;
+        case '*':
+            value = address * number;
+            return true;
+        case '/':
+            if (number == 0 || address % number != 0)
+                return false;
+            value = address / number;
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Só SIMBOLO, SIMBOLO + N e SIMBOLO - N continuam sendo endereços
+    static constexpr bool isRelocatable(char op)
+    {
+        return op == 0 || op == '+' || op == '-';
+    }
+
+private:
+    static constexpr bool isSeparator(char ch)
+    {
+        return ch == ' ' || ch == '\t' || ch == ',';
+    }
+
+    static constexpr bool isDigit(char ch)
+    {
+        return ch >= '0' && ch <= '9';
+    }
+};
+
+#endif // LEXER_H
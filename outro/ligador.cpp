@@ -0,0 +1,107 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "linker.h"
+#include "cache.h"
+#include "stats.h"
+
+namespace {
+    std::string readFile(const std::string& path) {
+        std::ifstream input(path, std::ios::binary);
+        if (!input) {
+            throw std::runtime_error("Could not open input file: " + path);
+        }
+        std::stringstream content;
+        content << input.rdbuf();
+        return content.str();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Linker linker;
+    std::vector<std::string> objFiles;
+    std::string profileFile, verifyFile;
+    bool collectGarbage = false;
+    bool textOutput = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-prof" && i + 1 < argc) {
+            profileFile = argv[++i];
+            linker.setProfile(profileFile);
+        } else if (arg == "-verify" && i + 1 < argc) {
+            verifyFile = argv[++i];
+            linker.setVerifyInput(verifyFile);
+        } else if (arg == "--stats=json") {
+            Stats::enable();
+        } else if (arg == "--stats=alloc") {
+            Stats::trackAllocationSites(20);
+        } else if (arg == "-gc") {
+            collectGarbage = true;
+            linker.setCollectGarbage(true);
+        } else if (arg == "-text") {
+            textOutput = true;
+            linker.setTextOutput(true);
+        } else {
+            objFiles.push_back(arg);
+        }
+    }
+
+    if (objFiles.size() < 2) {
+        std::cerr << "Usage: " << argv[0] << " [-gc] [-text] [-prof prog.prof [-verify inputs.txt]] [--stats=json|alloc] <prog1.obj> <prog2.obj> [<progN.obj>...]" << std::endl;
+        return 1;
+    }
+
+    if (Stats::enabled()) {
+        std::atexit([] { Stats::writeJson(std::cerr); });
+    }
+
+    std::string objFile1 = objFiles[0];
+    std::string outputFile = objFile1.substr(0, objFile1.find_last_of('.')) + ".e";
+
+    try {
+        // The cache key covers every input that can change the image: objects in order, flags and profile
+        std::unique_ptr<BuildCache> cache = BuildCache::fromEnvironment();
+        std::string key;
+        if (cache) {
+            std::vector<std::string> inputs;
+            for (const auto& objFile : objFiles) {
+                inputs.push_back(readFile(objFile));
+            }
+            std::string options = collectGarbage ? "-gc" : "";
+            if (textOutput) {
+                options += " -text";
+            }
+            if (!profileFile.empty()) {
+                inputs.push_back(readFile(profileFile));
+                options += " -prof";
+            }
+            if (!verifyFile.empty()) {
+                inputs.push_back(readFile(verifyFile));
+                options += " -verify";
+            }
+            key = BuildCache::key("link", options, inputs);
+
+            std::string image;
+            if (cache->lookup(key, image)) {
+                std::ofstream output(outputFile, std::ios::binary);
+                output << image;
+                std::cout << "Cache hit: linked output written to " << outputFile << std::endl;
+                return 0;
+            }
+        }
+
+        linker.link(objFiles, outputFile);
+        if (cache) {
+            cache->store(key, readFile(outputFile));
+        }
+        std::cout << "Linked output written to " << outputFile << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
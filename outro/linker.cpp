@@ -4,129 +4,332 @@
 #include <string>
 #include <unordered_map>
 #include <vector>
+#include <algorithm>
+#include <numeric>
 #include <stdexcept>
+#include <queue>
+#include "linker.h"
+#include "simulator.h"
+#include "stats.h"
 
-class Linker {
-public:
-    void link(const std::string& objFile1, const std::string& objFile2, const std::string& outputFile);
-    
-private:
-    void parseOBJFile(const std::string& filePath, std::unordered_map<std::string, int>& symbolTable,
-                      std::vector<std::pair<std::string, int>>& usageTable, std::vector<int>& code,
-                      std::string& relocationTable, int& moduleSize);
-    void resolveReferences(std::unordered_map<std::string, int>& globalSymbolTable, std::vector<std::pair<std::string, int>>& usageTable,
-                           std::vector<int>& code);
-};
-
-void Linker::link(const std::string& objFile1, const std::string& objFile2, const std::string& outputFile) {
-    std::unordered_map<std::string, int> globalSymbolTable;
-    std::vector<std::pair<std::string, int>> usageTable1, usageTable2;
-    std::vector<int> code1, code2;
-    std::string relocationTable1, relocationTable2;
-    int moduleSize1 = 0, moduleSize2 = 0;
-
-    // Parse the OBJ files and extract relevant data
-    parseOBJFile(objFile1, globalSymbolTable, usageTable1, code1, relocationTable1, moduleSize1);
-    parseOBJFile(objFile2, globalSymbolTable, usageTable2, code2, relocationTable2, moduleSize2);
-
-    // Correction factors
-    int correctionFactor2 = moduleSize1;
-
-    // Resolve references in both code sets
-    resolveReferences(globalSymbolTable, usageTable1, code1);
-    resolveReferences(globalSymbolTable, usageTable2, code2);
-
-    // Adjust relocation for the second module
-    for (size_t i = 0; i < relocationTable2.size(); ++i) {
-        if (relocationTable2[i] == '1') {
-            code2[i] += correctionFactor2;
-        }
+void Linker::setProfile(const std::string& file) {
+    profileFile = file;
+}
+
+void Linker::setVerifyInput(const std::string& file) {
+    verifyInputFile = file;
+}
+
+void Linker::setCollectGarbage(bool enabled) {
+    collectGarbage = enabled;
+}
+
+void Linker::setTextOutput(bool enabled) {
+    textOutput = enabled;
+}
+
+void Linker::link(const std::vector<std::string>& objFiles, const std::string& outputFile) {
+    std::vector<Module> modules(objFiles.size());
+    for (size_t i = 0; i < objFiles.size(); ++i) {
+        parseOBJFile(objFiles[i], modules[i]);
     }
+    ExecutableImage image = linkExecutable(modules);
 
-    // Write the linked output to a file
-    std::ofstream output(outputFile);
+    // Write the linked output to a file: the binary executable, or its text form on request
+    std::ofstream output(outputFile, std::ios::binary);
     if (!output) {
         throw std::runtime_error("Could not open output file: " + outputFile);
     }
+    if (textOutput) {
+        Executable::writeText(image, output);
+    } else {
+        Executable::write(image, output);
+    }
+}
+
+std::vector<int> Linker::link(const std::vector<Module>& modules) {
+    return linkExecutable(modules).code;
+}
+
+ExecutableImage Linker::linkExecutable(const std::vector<Module>& modules) {
+    ScopedTimer timer("link");
+    Stats::count("modules", static_cast<long>(modules.size()));
+    // Command line order; the profile was recorded against an image linked in this order
+    std::vector<size_t> order(modules.size());
+    std::iota(order.begin(), order.end(), 0);
+    if (collectGarbage) {
+        order = liveModules(modules);
+    }
+    ExecutableImage image = layout(modules, order);
+
+    if (!profileFile.empty()) {
+        std::vector<size_t> hotOrder = profileGuidedOrder(modules, order);
+        ExecutableImage hotImage = layout(modules, hotOrder);
+        if (!verifyInputFile.empty()) {
+            verify(image.code, hotImage.code);
+        }
+        image = std::move(hotImage);
+    }
+    return image;
+}
+
+int Module::textWords() const {
+    return textSize < 0 ? static_cast<int>(code.size()) : textSize;
+}
+
+// Module-local addresses below the TEXT size belong to TEXT, the rest to DATA
+int Placement::address(const std::vector<Module>& modules, size_t index, int local) const {
+    int textWords = modules[index].textWords();
+    if (local < textWords || textWords == static_cast<int>(modules[index].code.size())) {
+        return textBase[index] + local;
+    }
+    return dataBase[index] + local - textWords;
+}
+
+// Merges the TEXT sections of all modules in the given order, then their DATA sections
+Placement Linker::place(const std::vector<Module>& modules, const std::vector<size_t>& order) {
+    Placement placement;
+    placement.textBase.assign(modules.size(), 0);
+    placement.dataBase.assign(modules.size(), 0);
+    int base = 0;
+    for (size_t index : order) {
+        placement.textBase[index] = base;
+        base += modules[index].textWords();
+    }
+    placement.textSize = base;
+    for (size_t index : order) {
+        placement.dataBase[index] = base;
+        base += static_cast<int>(modules[index].code.size()) - modules[index].textWords();
+    }
+    placement.size = base;
+    return placement;
+}
+
+// Lays the modules out section by section and fixes up every relocation and usage site.
+// Both kinds of site hold an image address afterwards, so both are marked in the relocation map
+ExecutableImage Linker::layout(const std::vector<Module>& modules, const std::vector<size_t>& order) {
+    Placement placement = place(modules, order);
+
+    std::unordered_map<std::string, int> globalSymbolTable;
+    for (size_t index : order) {
+        for (const auto& [symbol, address] : modules[index].definitionTable) {
+            if (globalSymbolTable.find(symbol) != globalSymbolTable.end()) {
+                throw std::runtime_error("Duplicate symbol: " + symbol);
+            }
+            globalSymbolTable[symbol] = placement.address(modules, index, address);
+        }
+    }
+
+    ExecutableImage image;
+    image.code.assign(placement.size, 0);
+    image.relocation.assign(placement.size, '0');
+    image.textSize = placement.textSize;
+    for (size_t index : order) {
+        const Module& module = modules[index];
+        std::vector<int> code = module.code;
+        std::string relocation(code.size(), '0');
+
+        // Relative addresses move with the section they point into
+        for (size_t i = 0; i < module.relocationTable.size() && i < code.size(); ++i) {
+            if (module.relocationTable[i] == '1') {
+                code[i] = placement.address(modules, index, code[i]);
+                relocation[i] = '1';
+            }
+        }
+
+        // External references add the already relocated global address to the addend left by the assembler
+        resolveReferences(globalSymbolTable, module.usageTable, code);
+        for (const auto& [symbol, pos] : module.usageTable) {
+            relocation[pos] = '1';
+        }
+        for (size_t i = 0; i < code.size(); ++i) {
+            int address = placement.address(modules, index, static_cast<int>(i));
+            image.code[address] = code[i];
+            image.relocation[address] = relocation[i];
+        }
+    }
 
-    for (const auto& code : code1) {
-        output << code << " ";
+    image.symbols.assign(globalSymbolTable.begin(), globalSymbolTable.end());
+    std::sort(image.symbols.begin(), image.symbols.end(), [](const auto& a, const auto& b) {
+        return a.second != b.second ? a.second < b.second : a.first < b.first;
+    });
+    return image;
+}
+
+// Keeps only the modules reachable from the entry module through definition -> usage edges
+std::vector<size_t> Linker::liveModules(const std::vector<Module>& modules) {
+    std::unordered_map<std::string, size_t> definedIn;
+    for (size_t i = 0; i < modules.size(); ++i) {
+        for (const auto& [symbol, address] : modules[i].definitionTable) {
+            definedIn.emplace(symbol, i);
+        }
     }
-    for (const auto& code : code2) {
-        output << code << " ";
+
+    std::vector<bool> live(modules.size(), false);
+    std::queue<size_t> pending;
+    live[0] = true;
+    pending.push(0);
+    while (!pending.empty()) {
+        size_t index = pending.front();
+        pending.pop();
+        for (const auto& [symbol, pos] : modules[index].usageTable) {
+            auto it = definedIn.find(symbol);
+            if (it != definedIn.end() && !live[it->second]) {
+                live[it->second] = true;
+                pending.push(it->second);
+            }
+        }
     }
-    output.close();
+
+    std::vector<size_t> order;
+    size_t removedWords = 0;
+    for (size_t i = 0; i < modules.size(); ++i) {
+        if (live[i]) {
+            order.push_back(i);
+        } else {
+            std::cout << "Removed unreferenced module " << modules[i].fileName << " (" << modules[i].code.size() << " words)" << std::endl;
+            removedWords += modules[i].code.size();
+        }
+    }
+    std::cout << "Dead module elimination: " << removedWords << " words (" << removedWords * sizeof(int) << " bytes) removed" << std::endl;
+    return order;
 }
 
-void Linker::parseOBJFile(const std::string& filePath, std::unordered_map<std::string, int>& symbolTable,
-                          std::vector<std::pair<std::string, int>>& usageTable, std::vector<int>& code,
-                          std::string& relocationTable, int& moduleSize) {
+// Reads the "address count" profile written by the simulator and moves the hottest modules
+// right after the entry module, which must stay at address 0
+std::vector<size_t> Linker::profileGuidedOrder(const std::vector<Module>& modules, const std::vector<size_t>& order) {
+    std::ifstream input(profileFile);
+    if (!input) {
+        throw std::runtime_error("Could not open profile file: " + profileFile);
+    }
+
+    // Section ends in image order: the TEXT of every module, then the DATA of every module
+    Placement placement = place(modules, order);
+    std::vector<long> heat(modules.size(), 0);
+    std::vector<int> ends;
+    std::vector<size_t> owners;
+    for (size_t index : order) {
+        ends.push_back(placement.textBase[index] + modules[index].textWords());
+        owners.push_back(index);
+    }
+    for (size_t index : order) {
+        ends.push_back(placement.dataBase[index] + static_cast<int>(modules[index].code.size()) - modules[index].textWords());
+        owners.push_back(index);
+    }
+
+    int address;
+    long count;
+    while (input >> address >> count) {
+        auto it = std::upper_bound(ends.begin(), ends.end(), address);
+        if (address < 0 || it == ends.end()) {
+            throw std::runtime_error("Profile address out of range: " + std::to_string(address));
+        }
+        heat[owners[it - ends.begin()]] += count;
+    }
+
+    std::vector<size_t> hotOrder = order;
+    if (hotOrder.size() > 1) {
+        std::stable_sort(hotOrder.begin() + 1, hotOrder.end(), [&heat](size_t a, size_t b) {
+            return heat[a] > heat[b];
+        });
+    }
+
+    std::cout << "Profile-guided module order:";
+    for (size_t index : hotOrder) {
+        std::cout << " " << modules[index].fileName << "(" << heat[index] << ")";
+    }
+    std::cout << std::endl;
+    return hotOrder;
+}
+
+// Runs both layouts with the same input and requires identical output
+void Linker::verify(const std::vector<int>& before, const std::vector<int>& after) {
+    std::ifstream inputFile(verifyInputFile);
+    if (!inputFile) {
+        throw std::runtime_error("Could not open verification input: " + verifyInputFile);
+    }
+    std::stringstream inputs;
+    inputs << inputFile.rdbuf();
+
+    std::istringstream inputBefore(inputs.str()), inputAfter(inputs.str());
+    std::ostringstream outputBefore, outputAfter;
+    Simulator(before).run(inputBefore, outputBefore);
+    Simulator(after).run(inputAfter, outputAfter);
+
+    if (outputBefore.str() != outputAfter.str()) {
+        throw std::runtime_error("Verification failed: reordered image produced different output");
+    }
+    std::cout << "Verification passed" << std::endl;
+}
+
+void Linker::parseOBJFile(const std::string& filePath, Module& module) {
     std::ifstream input(filePath);
     if (!input) {
         throw std::runtime_error("Could not open input file: " + filePath);
     }
+    module = readModule(input, filePath);
+}
 
+Module Linker::readModule(std::istream& input, const std::string& name) {
+    Module module;
+    module.fileName = name;
+
+    // Objects written by the assembler list their tables after "DEFINITION TABLE:" / "USAGE TABLE:"
     std::string line;
+    std::string table;
     while (std::getline(input, line)) {
         std::istringstream iss(line);
         std::string token;
         iss >> token;
 
-        if (token == "USO") {
+        if (line == "DEFINITION TABLE:" || line == "USAGE TABLE:") {
+            table = line;
+        } else if (table == "DEFINITION TABLE:") {
+            int address;
+            if (iss >> address) {
+                module.definitionTable[token] = address;
+            }
+        } else if (table == "USAGE TABLE:") {
+            int pos;
+            while (iss >> pos) {
+                module.usageTable.emplace_back(token, pos);
+            }
+        } else if (token == "USO") {
             std::string symbol;
             int pos;
             while (iss >> symbol >> pos) {
-                usageTable.emplace_back(symbol, pos);
+                module.usageTable.emplace_back(symbol, pos);
             }
         } else if (token == "DEF") {
             std::string symbol;
             int address;
             while (iss >> symbol >> address) {
-                symbolTable[symbol] = address;
+                module.definitionTable[symbol] = address;
             }
         } else if (token == "REAL") {
-            iss >> relocationTable;
+            iss >> module.relocationTable;
+        } else if (token == "SECTIONS") {
+            int dataSize;
+            iss >> module.textSize >> dataSize;
         } else {
+            std::istringstream values(line);
             int value;
-            while (iss >> value) {
-                code.push_back(value);
+            while (values >> value) {
+                module.code.push_back(value);
             }
-            moduleSize += code.size();
         }
     }
-    input.close();
+    return module;
 }
 
-void Linker::resolveReferences(std::unordered_map<std::string, int>& globalSymbolTable, std::vector<std::pair<std::string, int>>& usageTable,
+void Linker::resolveReferences(std::unordered_map<std::string, int>& globalSymbolTable, const std::vector<std::pair<std::string, int>>& usageTable,
                                std::vector<int>& code) {
     for (const auto& [symbol, pos] : usageTable) {
         if (globalSymbolTable.find(symbol) != globalSymbolTable.end()) {
-            int symbolAddress = globalSymbolTable[symbol];
-            code[pos] = symbolAddress;
+            // The word holds the addend of "SYMBOL + N" (0 for a plain reference)
+            code[pos] += globalSymbolTable[symbol];
         } else {
             throw std::runtime_error("Undefined symbol: " + symbol);
         }
     }
 }
-
-int main(int argc, char* argv[]) {
-    if (argc != 3) {
-        std::cerr << "Usage: " << argv[0] << " <prog1.obj> <prog2.obj>" << std::endl;
-        return 1;
-    }
-
-    std::string objFile1 = argv[1];
-    std::string objFile2 = argv[2];
-    std::string outputFile = objFile1.substr(0, objFile1.find_last_of('.')) + ".e";
-
-    Linker linker;
-    try {
-        linker.link(objFile1, objFile2, outputFile);
-        std::cout << "Linked output written to " << outputFile << std::endl;
-    } catch (const std::exception& e) {
-        std::cerr << "Error: " << e.what() << std::endl;
-        return 1;
-    }
-
-    return 0;
-}
@@ -0,0 +1,60 @@
+#ifndef LINKER_H
+#define LINKER_H
+
+#include <istream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "executable.h"
+
+struct Module {
+    std::string fileName;
+    std::unordered_map<std::string, int> definitionTable;
+    std::vector<std::pair<std::string, int>> usageTable;
+    std::vector<int> code;
+    std::string relocationTable;
+    int textSize = -1; // Words of the TEXT section; -1 when the object has no SECTIONS header (all TEXT)
+
+    int textWords() const;
+};
+
+// Where each module's sections land in the image: all TEXT sections first, then all DATA sections
+struct Placement {
+    std::vector<int> textBase;
+    std::vector<int> dataBase;
+    int textSize = 0;
+    int size = 0;
+
+    int address(const std::vector<Module>& modules, size_t index, int local) const;
+};
+
+class Linker {
+public:
+    void link(const std::vector<std::string>& objFiles, const std::string& outputFile);
+    std::vector<int> link(const std::vector<Module>& modules);
+    // Image plus what the binary executable carries: TEXT size, relocation map and global symbols
+    ExecutableImage linkExecutable(const std::vector<Module>& modules);
+    static Module readModule(std::istream& input, const std::string& name);
+    void setProfile(const std::string& profileFile);
+    void setVerifyInput(const std::string& inputFile);
+    void setCollectGarbage(bool enabled);
+    void setTextOutput(bool enabled);
+
+private:
+    void parseOBJFile(const std::string& filePath, Module& module);
+    ExecutableImage layout(const std::vector<Module>& modules, const std::vector<size_t>& order);
+    static Placement place(const std::vector<Module>& modules, const std::vector<size_t>& order);
+    void resolveReferences(std::unordered_map<std::string, int>& globalSymbolTable, const std::vector<std::pair<std::string, int>>& usageTable,
+                           std::vector<int>& code);
+    std::vector<size_t> liveModules(const std::vector<Module>& modules);
+    std::vector<size_t> profileGuidedOrder(const std::vector<Module>& modules, const std::vector<size_t>& order);
+    void verify(const std::vector<int>& before, const std::vector<int>& after);
+
+    std::string profileFile;
+    std::string verifyInputFile;
+    bool collectGarbage = false;
+    bool textOutput = false;
+};
+
+#endif // LINKER_H
@@ -0,0 +1,84 @@
+#include "loader.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+Loader::Loader(size_t capacity)
+    : arena(capacity, 0)
+{
+}
+
+size_t Loader::load(const MappedExecutable &executable, const std::string &name, int base)
+{
+    return place(executable.memory(), executable.words(), executable.relocationBitmap(), executable.header().entry, name, base);
+}
+
+size_t Loader::load(const ExecutableImage &image, const std::string &name, int base)
+{
+    std::string bitmap;
+    if (!image.relocation.empty())
+        bitmap = Executable::packRelocation(image.relocation, image.code.size());
+    return place(image.code.data(), image.code.size(), bitmap.empty() ? nullptr : reinterpret_cast<const unsigned char *>(bitmap.data()),
+                 image.entry, name, base);
+}
+
+size_t Loader::place(const int *words, size_t count, const unsigned char *bitmap, int entry, const std::string &name, int base)
+{
+    if (base < 0)
+        base = static_cast<int>(end);
+    if (static_cast<size_t>(base) + count > arena.size())
+        throw std::runtime_error("Error: " + name + " does not fit in memory at base " + std::to_string(base));
+    for (const auto &program : loaded)
+    {
+        if (base < program.base + program.size && program.base < base + static_cast<int>(count))
+            throw std::runtime_error("Error: " + name + " overlaps " + program.name + " at base " + std::to_string(base));
+    }
+    // Sem mapa não há como saber quais palavras são endereços
+    if (bitmap == nullptr && base != 0)
+        throw std::runtime_error("Error: " + name + " has no relocation map and can only be loaded at base 0");
+
+    int *target = arena.data() + base;
+    std::memcpy(target, words, count * sizeof(int));
+    if (base != 0)
+        relocate(target, bitmap, count, base);
+    loaded.push_back({name, base, static_cast<int>(count), entry + base});
+    end = std::max(end, static_cast<size_t>(base) + count);
+    return loaded.size() - 1;
+}
+
+// A máscara (0 ou ~0) sai do bit, então o laço interno é fixo e sem desvios, e o compilador
+// o vetoriza; bytes zerados do mapa, comuns no DATA, são pulados
+void Loader::relocate(int *words, const unsigned char *bitmap, size_t count, int delta)
+{
+    unsigned offset = static_cast<unsigned>(delta);
+    size_t full = count / 8;
+    for (size_t byte = 0; byte < full; ++byte)
+    {
+        unsigned bits = bitmap[byte];
+        if (bits == 0)
+            continue;
+        unsigned *block = reinterpret_cast<unsigned *>(words) + byte * 8;
+        for (unsigned k = 0; k < 8; ++k)
+            block[k] += offset & (0u - ((bits >> k) & 1u));
+    }
+    for (size_t i = full * 8; i < count; ++i)
+    {
+        if (bitmap[i / 8] >> (i % 8) & 1)
+            words[i] = static_cast<int>(static_cast<unsigned>(words[i]) + offset);
+    }
+}
+
+int *Loader::memory()
+{
+    return arena.data();
+}
+
+size_t Loader::size() const
+{
+    return end;
+}
+
+const std::vector<LoadedProgram> &Loader::programs() const
+{
+    return loaded;
+}
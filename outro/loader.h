@@ -0,0 +1,43 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <string>
+#include <vector>
+#include "executable.h"
+
+struct LoadedProgram
+{
+    std::string name;
+    int base;
+    int size;
+    int entry; // Já somado à base
+};
+
+// Carregador com relocação: coloca vários executáveis numa única memória simulada, cada um
+// na base escolhida. As palavras marcadas no mapa de relocação guardam endereços da imagem
+// ligada a partir de 0 e recebem a base; a memória é alocada uma vez, na capacidade dada
+class Loader
+{
+public:
+    explicit Loader(size_t capacity);
+
+    // Base -1: logo depois do último programa carregado. Devolve o índice do programa
+    size_t load(const MappedExecutable &executable, const std::string &name, int base = -1);
+    size_t load(const ExecutableImage &image, const std::string &name, int base = -1);
+
+    int *memory();
+    size_t size() const; // Palavras até o fim do programa mais alto
+    const std::vector<LoadedProgram> &programs() const;
+
+    // Soma delta às palavras cujo bit está ligado no mapa; oito palavras por byte do mapa, sem desvio
+    static void relocate(int *words, const unsigned char *bitmap, size_t count, int delta);
+
+private:
+    size_t place(const int *words, size_t count, const unsigned char *bitmap, int entry, const std::string &name, int base);
+
+    std::vector<int> arena;
+    std::vector<LoadedProgram> loaded;
+    size_t end = 0;
+};
+
+#endif // LOADER_H
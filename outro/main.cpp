@@ -1,47 +1,291 @@
-#include <iostream>
-#include "assembler.h"
-#include "preprocessor.h"
-#include "utils.h"
-
-
-
-int main(int argc, char *argv[])
-{
-    if (argc < 3)
-    {
-        std::cerr << "Usage: " << argv[0] << " -p input.asm | -o input.pre" << std::endl;
-        return 1;
-    }
-
-    std::string mode = argv[1];
-    std::string inputFile = argv[2];
-
-    try
-    {
-        Utils utils;
-        if (mode == "-p")
-        {
-            Preprocessor preprocessor;
-            std::string preprocessedFile = utils.replaceExtension(inputFile, ".pre");
-            preprocessor.preprocess(inputFile, preprocessedFile);
-        }
-        else if (mode == "-o")
-        {
-            Assembler assembler;
-            std::string preprocessedFile = utils.replaceExtension(inputFile, ".obj");
-            assembler.assemble(inputFile, preprocessedFile);
-        }
-        else
-        {
-            std::cerr << "Unknown mode: " << mode << std::endl;
-            return 1;
-        }
-    }
-    catch (const std::exception &e)
-    {
-        std::cerr << e.what() << std::endl;
-        return 1;
-    }
-
-    return 0;
-}
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include "assembler.h"
+#include "preprocessor.h"
+#include "utils.h"
+#include "simulator.h"
+#include "driver.h"
+#include "linker.h"
+#include "cache.h"
+#include "incremental.h"
+#include "watcher.h"
+#include "stats.h"
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <thread>
+
+namespace
+{
+    std::string readFile(const std::string &path)
+    {
+        std::ifstream input(path);
+        if (!input)
+            throw std::runtime_error("Error: Could not open input file: " + path);
+        std::stringstream content;
+        content << input.rdbuf();
+        return content.str();
+    }
+
+    // Com MONTADOR_CACHE definido, reaproveita o artefato de uma execução anterior com as mesmas entradas
+    void buildCached(const std::string &tool, const std::string &inputFile, const std::string &outputFile,
+                     const std::function<void(std::istream &, std::ostream &)> &build)
+    {
+        std::string source;
+        {
+            ScopedTimer timer("read");
+            source = readFile(inputFile);
+        }
+        std::unique_ptr<BuildCache> cache = BuildCache::fromEnvironment();
+        if (tool == "preprocess" && Preprocessor::hasIncludes(source))
+            cache.reset(); // Os arquivos incluídos já têm cache próprio no pré-processador
+        std::string artifact;
+        std::string key;
+        bool hit = false;
+        if (cache)
+        {
+            key = BuildCache::key(tool, "", {source});
+            hit = cache->lookup(key, artifact);
+            if (hit)
+                std::cout << "Cache hit: " << outputFile << std::endl;
+        }
+        if (!hit)
+        {
+            std::istringstream input(source);
+            std::ostringstream output;
+            build(input, output);
+            artifact = output.str();
+            if (cache)
+                cache->store(key, artifact);
+        }
+
+        std::ofstream output(outputFile);
+        if (!output)
+            throw std::runtime_error("Error: Could not open output file: " + outputFile);
+        output << artifact;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    // --stats=json vale em qualquer modo e posição; o relatório vai para stderr ao terminar.
+    // --stats=alloc inclui os locais que mais alocam
+    std::vector<char *> arguments;
+    for (int i = 0; i < argc; ++i)
+    {
+        if (std::string(argv[i]) == "--stats=json")
+            Stats::enable();
+        else if (std::string(argv[i]) == "--stats=alloc")
+            Stats::trackAllocationSites(20);
+        else
+            arguments.push_back(argv[i]);
+    }
+    argc = static_cast<int>(arguments.size());
+    argv = arguments.data();
+    if (Stats::enabled())
+        std::atexit([]
+                    { Stats::writeJson(std::cerr); });
+
+    if (argc == 2 && std::string(argv[1]) == "-s")
+    {
+        std::unique_ptr<BuildCache> cache = BuildCache::fromEnvironment();
+        if (!cache)
+        {
+            std::cerr << "MONTADOR_CACHE is not set" << std::endl;
+            return 1;
+        }
+        cache->printStatistics(std::cout);
+        return 0;
+    }
+
+    if (argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " -p input.asm | -o input.pre [-t threads] | -O input.pre [inputs.txt]"
+                  << " | -i input.pre | --watch [-e prog.e] files..."
+                  << " | -b [-t threads] [-e prog.e] files|dirs... | -s; any mode accepts --stats=json|alloc" << std::endl;
+        return 1;
+    }
+
+    std::string mode = argv[1];
+    std::string inputFile = argv[2];
+
+    try
+    {
+        Utils utils;
+        if (mode == "-p")
+        {
+            std::string preprocessedFile = utils.replaceExtension(inputFile, ".pre");
+            buildCached("preprocess", inputFile, preprocessedFile, [&inputFile](std::istream &input, std::ostream &output)
+                        {
+                            Preprocessor preprocessor;
+                            preprocessor.setIncludeDirectory(std::filesystem::path(inputFile).parent_path().string());
+                            preprocessor.preprocess(input, output); });
+        }
+        else if (mode == "-o")
+        {
+            Assembler assembler;
+            assembler.setTrace(std::cout);
+            if (argc > 4 && std::string(argv[3]) == "-t")
+                assembler.setThreads(std::stoi(argv[4]));
+            std::string objectFile = utils.replaceExtension(inputFile, ".obj");
+            buildCached("assemble", inputFile, objectFile, [&assembler](std::istream &input, std::ostream &output)
+                        { assembler.assemble(input, output); });
+        }
+        else if (mode == "-i")
+        {
+            // Montagem incremental: o estado da última execução fica em input.inc
+            std::string stateFile = utils.replaceExtension(inputFile, ".inc");
+            IncrementalAssembler assembler;
+            std::ifstream previousState(stateFile);
+            if (previousState)
+                assembler.load(previousState);
+            previousState.close();
+
+            std::ifstream input(inputFile);
+            if (!input)
+                throw std::runtime_error("Error: Could not open input file: " + inputFile);
+            std::vector<std::string> lines;
+            std::string line;
+            while (std::getline(input, line))
+                lines.push_back(line);
+
+            ObjectCode object = assembler.assemble(lines);
+            for (const auto &diagnostic : object.diagnostics)
+            {
+                if (diagnostic.isError)
+                    throw std::runtime_error(diagnostic.message);
+            }
+            std::ofstream output(utils.replaceExtension(inputFile, ".obj"));
+            Assembler::writeObject(object, output);
+            std::ofstream state(stateFile);
+            assembler.save(state);
+
+            const IncrementalStats &stats = assembler.getStats();
+            std::cout << "Incremental: " << stats.linesRelexed << " of " << lines.size() << " lines re-lexed, "
+                      << stats.linesResolved << " re-resolved";
+            if (stats.fullRebuild)
+                std::cout << " (full build)";
+            else if (stats.firstChangedAddress < 0)
+                std::cout << " (unchanged)";
+            else if (stats.patchedInPlace)
+                std::cout << " (patched in place)";
+            else
+                std::cout << " (recomputed from address " << stats.firstChangedAddress << ")";
+            std::cout << std::endl;
+        }
+        else if (mode == "--watch")
+        {
+            // Refaz .pre, .obj e o executável a cada alteração dos fontes
+            std::string executableFile;
+            std::vector<std::string> sources;
+            for (int i = 2; i < argc; ++i)
+            {
+                std::string arg = argv[i];
+                if (arg == "-e" && i + 1 < argc)
+                    executableFile = argv[++i];
+                else
+                    sources.push_back(arg);
+            }
+            Watcher watcher(sources, executableFile, std::cout);
+            watcher.run();
+        }
+        else if (mode == "-O")
+        {
+            Assembler assembler;
+            assembler.setOptimize(true);
+            std::string objectFile = utils.replaceExtension(inputFile, ".obj");
+            assembler.assemble(inputFile, objectFile);
+
+            const OptimizerStats &stats = assembler.getOptimizerStats();
+            std::cout << "Optimizer: " << stats.wordsSaved << " words saved, "
+                      << stats.instructionsRemoved << " instructions removed ("
+                      << stats.redundantLoads << " redundant loads, "
+                      << stats.unreachableInstructions << " unreachable), "
+                      << stats.jumpChains << " jump chains collapsed" << std::endl;
+
+            // Com um arquivo de entradas, simula as duas versões e compara
+            if (argc > 3)
+            {
+                std::ifstream source(inputFile), inputs(argv[3]);
+                if (!inputs)
+                    throw std::runtime_error("Error: Could not open inputs file: " + std::string(argv[3]));
+                std::stringstream inputValues;
+                inputValues << inputs.rdbuf();
+
+                std::ostringstream plainObject;
+                Assembler plain;
+                plain.assemble(source, plainObject);
+                std::ifstream optimizedObject(objectFile);
+
+                std::istringstream plainInput(inputValues.str()), optimizedInput(inputValues.str());
+                std::ostringstream plainOutput, optimizedOutput;
+                std::istringstream plainImage(plainObject.str());
+                Simulator before(Simulator::loadImage(plainImage));
+                Simulator after(Simulator::loadImage(optimizedObject));
+                before.run(plainInput, plainOutput);
+                after.run(optimizedInput, optimizedOutput);
+
+                if (plainOutput.str() != optimizedOutput.str())
+                    throw std::runtime_error("Error: Optimized program produced different output");
+                std::cout << "Simulated instructions: " << before.getInstructionCount() << " -> "
+                          << after.getInstructionCount() << " (" << before.getInstructionCount() - after.getInstructionCount()
+                          << " fewer)" << std::endl;
+            }
+        }
+        else if (mode == "-b")
+        {
+            // Montagem de vários arquivos em paralelo, opcionalmente ligando em memória
+            unsigned threads = std::thread::hardware_concurrency();
+            std::string executableFile;
+            std::vector<std::string> paths;
+            for (int i = 2; i < argc; ++i)
+            {
+                std::string arg = argv[i];
+                if (arg == "-t" && i + 1 < argc)
+                    threads = std::stoi(argv[++i]);
+                else if (arg == "-e" && i + 1 < argc)
+                    executableFile = argv[++i];
+                else
+                    paths.push_back(arg);
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            BatchDriver driver(threads);
+            std::vector<BatchResult> results = driver.run(BatchDriver::collectInputs(paths));
+            double wall = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            BatchDriver::printSummary(results, wall, std::cout);
+
+            for (const auto &result : results)
+            {
+                if (!result.error.empty())
+                    return 1;
+            }
+
+            if (!executableFile.empty())
+            {
+                std::vector<Module> modules;
+                for (const auto &result : results)
+                {
+                    std::istringstream object(result.objectCode);
+                    modules.push_back(Linker::readModule(object, result.objectFile));
+                }
+                Executable::write(Linker().linkExecutable(modules), executableFile);
+                std::cout << "Linked output written to " << executableFile << std::endl;
+            }
+        }
+        else
+        {
+            std::cerr << "Unknown mode: " << mode << std::endl;
+            return 1;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,297 @@
+#include "optimizer.h"
+#include "assembler.h"
+#include "cfg.h"
+#include "isa.h"
+#include "lexer.h"
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+    struct Statement
+    {
+        std::string line;
+        std::string label;
+        std::string opcode;
+        std::vector<std::string> operands;
+        std::vector<std::string> labels; // Rótulos que marcam a instrução/dado
+        int address = -1;                // Na disposição do montador; -1 se removida
+        bool removed = false;
+    };
+
+    bool isInstruction(const std::string &opcode)
+    {
+        return Isa::find(opcode) != nullptr;
+    }
+
+    bool isJump(const std::string &opcode)
+    {
+        const InstructionInfo *info = Isa::find(opcode);
+        return info != nullptr && Isa::isJump(info->opcode);
+    }
+
+    int instructionSize(const std::string &opcode)
+    {
+        return Isa::size(Isa::find(opcode)->opcode);
+    }
+
+    // Operando na forma "SIMBOLO op N", em tokens separados ou juntos ("A+1")
+    bool hasExpression(const Statement &statement)
+    {
+        if (!isInstruction(statement.opcode))
+            return false;
+        size_t expected = statement.opcode == "COPY" ? 2 : 1;
+        if (statement.operands.size() > expected)
+            return true;
+        for (const auto &operand : statement.operands)
+        {
+            if (operand.find_first_of("+-*/", 1) != std::string::npos)
+                return true;
+        }
+        return false;
+    }
+
+    // Símbolo de um operando, sem a parte "op N"
+    std::string operandSymbol(const std::string &operand)
+    {
+        return operand.substr(0, operand.find_first_of("+-*/", 1));
+    }
+
+    int statementSize(const Statement &statement)
+    {
+        if (isInstruction(statement.opcode))
+            return instructionSize(statement.opcode);
+        if (statement.opcode == "CONST")
+            return 1;
+        if (statement.opcode != "SPACE")
+            return 0;
+        int count = 1;
+        if (!statement.operands.empty() && !Lexer::parseDecimal(statement.operands[0], count))
+            count = 1;
+        return std::max(count, 0);
+    }
+
+    // Palavras do programa na disposição do montador (TEXT, depois DATA), com os operandos
+    // resolvidos para os endereços dos rótulos locais. Operandos externos ou com expressão
+    // entram em external: o grafo de fluxo trata desvios para eles como saída do módulo
+    ControlFlowGraph buildGraph(std::vector<Statement> &statements, const std::unordered_map<std::string, size_t> &labelIndex)
+    {
+        int counter[2] = {0, 0};
+        bool data = false;
+        std::vector<char> inData(statements.size(), 0);
+        for (size_t i = 0; i < statements.size(); ++i)
+        {
+            Statement &statement = statements[i];
+            statement.address = -1;
+            if (statement.removed)
+                continue;
+            if (statement.opcode == "SECTION" && statement.operands.size() == 1)
+                data = statement.operands[0] == "DATA";
+            inData[i] = data;
+            statement.address = counter[data];
+            counter[data] += statementSize(statement);
+        }
+
+        std::vector<int> code(static_cast<size_t>(counter[0]) + counter[1], 0);
+        std::vector<int> external;
+        std::vector<int> entries = {0};
+        auto addressOf = [&](const std::string &symbol)
+        {
+            auto it = labelIndex.find(symbol);
+            return it == labelIndex.end() ? -1 : statements[it->second].address;
+        };
+        for (size_t i = 0; i < statements.size(); ++i)
+        {
+            Statement &statement = statements[i];
+            if (statement.removed)
+                continue;
+            if (inData[i])
+                statement.address += counter[0];
+            if (statement.opcode == "PUBLIC")
+            {
+                for (const auto &operand : statement.operands)
+                    entries.push_back(addressOf(operand));
+            }
+            else if (statement.opcode == "CONST")
+            {
+                int value = 0;
+                if (!statement.operands.empty() && Lexer::parseDecimal(statement.operands[0], value))
+                    code[statement.address] = value;
+            }
+            else if (isInstruction(statement.opcode))
+            {
+                code[statement.address] = Isa::find(statement.opcode)->opcode;
+                bool expression = hasExpression(statement);
+                for (size_t k = 0; k < statement.operands.size() && k + 1 < static_cast<size_t>(statementSize(statement)); ++k)
+                {
+                    int position = statement.address + 1 + static_cast<int>(k);
+                    const std::string &operand = statement.operands[k];
+                    int value = -1;
+                    if (!expression && Lexer::isNumber(operand))
+                        Lexer::parseDecimal(operand, value);
+                    else if (!expression)
+                        value = addressOf(operand);
+                    if (value < 0)
+                        external.push_back(position);
+                    else
+                        code[position] = value;
+                }
+            }
+        }
+        return ControlFlowGraph(code, entries, external);
+    }
+
+    std::string rebuildLine(const Statement &statement)
+    {
+        std::string result;
+        if (!statement.label.empty())
+            result = statement.label + ": ";
+        result += statement.opcode;
+        for (size_t i = 0; i < statement.operands.size(); ++i)
+            result += (i == 0 ? " " : ",") + statement.operands[i];
+        return result;
+    }
+}
+
+std::vector<std::string> Optimizer::optimize(const std::vector<std::string> &lines)
+{
+    Assembler parser;
+    std::vector<Statement> statements;
+    std::unordered_map<std::string, size_t> labelIndex; // Rótulo -> instrução/dado que ele marca
+    std::vector<std::string> pendingLabels;
+    stats = {};
+
+    for (const auto &line : lines)
+    {
+        Statement statement;
+        statement.line = line;
+        parser.parseTokens(parser.tokenize(line), statement.label, statement.opcode, statement.operands);
+        if (!statement.label.empty())
+            pendingLabels.push_back(statement.label);
+        if (!statement.opcode.empty())
+        {
+            for (const auto &label : pendingLabels)
+                labelIndex[label] = statements.size();
+            statement.labels.swap(pendingLabels);
+        }
+        statements.push_back(statement);
+    }
+
+    // Se algum rótulo de código é usado em expressão (ex.: JMP L1 + 2), remover palavras mudaria
+    // a distância relativa; nesse caso apenas reescritas sem remoção são feitas
+    bool allowRemoval = true;
+    for (const auto &statement : statements)
+    {
+        if (!hasExpression(statement))
+            continue;
+        for (const auto &operand : statement.operands)
+        {
+            auto it = labelIndex.find(operandSymbol(operand));
+            if (it != labelIndex.end() && isInstruction(statements[it->second].opcode))
+                allowRemoval = false;
+        }
+    }
+
+    auto remove = [this](Statement &statement)
+    {
+        statement.removed = true;
+        stats.instructionsRemoved++;
+        stats.wordsSaved += instructionSize(statement.opcode);
+    };
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+
+        // Encadeamento de desvios: JMPx L onde L: JMP M vira JMPx M
+        for (auto &statement : statements)
+        {
+            if (statement.removed || !isJump(statement.opcode) || statement.operands.size() != 1)
+                continue;
+            std::string target = statement.operands[0];
+            std::unordered_set<std::string> visited = {target};
+            while (true)
+            {
+                auto it = labelIndex.find(target);
+                if (it == labelIndex.end())
+                    break;
+                const Statement &next = statements[it->second];
+                if (next.opcode != "JMP" || next.operands.size() != 1 || visited.count(next.operands[0]))
+                    break;
+                target = next.operands[0];
+                visited.insert(target);
+            }
+            if (target != statement.operands[0])
+            {
+                statement.operands[0] = target;
+                statement.line = rebuildLine(statement);
+                stats.jumpChains++;
+                changed = true;
+            }
+        }
+
+        if (!allowRemoval)
+            break;
+
+        // Alcance e blocos básicos vêm do grafo de fluxo do programa atual. Rótulos citados
+        // por operandos ou PUBLIC continuam definidos mesmo sem desvio que os alcance
+        ControlFlowGraph graph = buildGraph(statements, labelIndex);
+        std::unordered_set<std::string> referenced;
+        for (const auto &statement : statements)
+        {
+            if (statement.removed)
+                continue;
+            for (const auto &operand : statement.operands)
+                referenced.insert(operandSymbol(operand));
+        }
+        auto removable = [&](const Statement &statement)
+        {
+            return std::none_of(statement.labels.begin(), statement.labels.end(), [&](const std::string &label)
+                                { return referenced.count(label) > 0; });
+        };
+
+        Statement *previous = nullptr;
+        for (auto &statement : statements)
+        {
+            if (statement.removed || statement.opcode.empty())
+                continue;
+
+            if (isInstruction(statement.opcode) && !graph.isInstructionStart(statement.address) && removable(statement))
+            {
+                // Código que nenhum caminho a partir das entradas alcança
+                remove(statement);
+                stats.unreachableInstructions++;
+                changed = true;
+                continue;
+            }
+
+            // STORE X seguido de LOAD X no mesmo bloco: o acumulador já contém X
+            if (previous != nullptr && statement.opcode == "LOAD" && previous->opcode == "STORE" &&
+                statement.operands.size() == 1 && previous->operands == statement.operands &&
+                graph.blockAt(statement.address) >= 0 && graph.blockAt(statement.address) == graph.blockAt(previous->address) &&
+                removable(statement))
+            {
+                remove(statement);
+                stats.redundantLoads++;
+                changed = true;
+                continue;
+            }
+            previous = &statement;
+        }
+    }
+
+    std::vector<std::string> result;
+    for (const auto &statement : statements)
+    {
+        if (!statement.removed)
+            result.push_back(statement.line);
+    }
+    return result;
+}
+
+const OptimizerStats &Optimizer::getStats() const
+{
+    return stats;
+}
@@ -0,0 +1,26 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include <string>
+#include <vector>
+
+struct OptimizerStats
+{
+    int wordsSaved = 0;
+    int instructionsRemoved = 0;
+    int redundantLoads = 0;
+    int jumpChains = 0;
+    int unreachableInstructions = 0;
+};
+
+class Optimizer
+{
+public:
+    std::vector<std::string> optimize(const std::vector<std::string> &lines);
+    const OptimizerStats &getStats() const;
+
+private:
+    OptimizerStats stats;
+};
+
+#endif // OPTIMIZER_H
@@ -1,145 +1,734 @@
-#include "preprocessor.h"
-#include "utils.h"
-#include <iostream>
-#include <fstream>
-#include <sstream>
-#include <unordered_map>
-#include <unordered_set>
-#include <vector>
-#include <regex>
-#include <algorithm>
-#include <stdexcept>
-
-void Preprocessor::preprocess(const std::string &inputFile, const std::string &outputFile)
-{
-        std::ifstream input(inputFile);
-        std::ofstream output(outputFile);
-        std::string line;
-        std::unordered_map<std::string, int> equMap;
-        std::vector<std::string> lines;
-        bool processNextLine = true;
-
-        // Primeiro passo: Processar todas as diretivas EQU
-        while (std::getline(input, line))
-        {
-            line = removeComments(line);
-            line = removeExtraSpaces(line);
-            if (line.empty())
-                continue;
-
-            if (std::regex_search(line, std::regex("\\bEQU\\b", std::regex_constants::icase)))
-            {
-                processEqu(line, equMap);
-            }
-            else
-            {
-                lines.push_back(line);
-            }
-        }
-
-        // Substituir valores de EQU nas linhas
-        for (auto &l : lines)
-        {
-            l = replaceEqu(l, equMap);
-        }
-
-        // Processar diretivas IF
-        auto it = lines.begin();
-        while (it != lines.end())
-        {
-            std::string currentLine = *it;
-
-            if (std::regex_search(currentLine, std::regex("\\bIF\\b", std::regex_constants::icase)))
-            {
-                // Processar diretiva IF e verificar a necessidade de incluir a linha seguinte
-                try
-                {
-                    // Armazena a próxima linha
-                    std::string nextLine;
-                    if (++it != lines.end())
-                    {
-                        nextLine = *it;
-                    }
-                    else
-                    {
-                        throw std::runtime_error("Error: No line following IF directive.");
-                    }
-
-                    processIf(currentLine, equMap, output, nextLine);
-                }
-                catch (const std::runtime_error &e)
-                {
-                    std::cerr << e.what() << std::endl;
-                    return; // Interromper a execução se houver erro
-                }
-            }
-            else
-            {
-                output << currentLine << std::endl;
-            }
-            ++it;
-        }
-    }
-
-void Preprocessor::processEqu(const std::string &line, std::unordered_map<std::string, int> &equMap)
-{
-        std::istringstream iss(line);
-        std::string label, equ, value;
-        std::getline(iss, label, ':'); // Ler o rótulo incluindo os dois pontos
-        iss >> equ >> value;
-        label = removeExtraSpaces(label); // Remove espaços extras ao redor do rótulo
-        if (!label.empty())
-        {
-            equMap[label] = std::stoi(value);
-        }
-}
-
-std::string Preprocessor::replaceEqu(const std::string &line, const std::unordered_map<std::string, int> &equMap)
-{
-    std::string result = line;
-    for (const auto &pair : equMap)
-    {
-        size_t pos = result.find(pair.first);
-        if (pos != std::string::npos)
-        {
-            result.replace(pos, pair.first.length(), std::to_string(pair.second));
-        }
-    }
-    return result;
-}
-
-void Preprocessor::processIf(const std::string &line, const std::unordered_map<std::string, int> &equMap, std::ofstream &output, const std::string &nextLine)
-{
-        std::istringstream iss(line);
-        std::string directive, conditionStr;
-        iss >> directive >> conditionStr;
-        conditionStr = removeExtraSpaces(conditionStr);
-
-        try
-        {
-            int condition = std::stoi(conditionStr); // Converte a condição para um valor numérico
-
-            if (condition == 1)
-            {
-                output << nextLine << std::endl;
-            }
-        }
-        catch (const std::invalid_argument &)
-        {
-            throw std::runtime_error("Error: Invalid condition in IF directive: " + conditionStr);
-        }
-        catch (const std::out_of_range &)
-        {
-            throw std::runtime_error("Error: Condition out of range in IF directive: " + conditionStr);
-        }
-    }
-
-std::string Preprocessor::removeComments(const std::string &line)
-{
-    return Utils::removeComments(line);
-}
-
-std::string Preprocessor::removeExtraSpaces(const std::string &line)
-{
-    return Utils::removeExtraSpaces(line);
-}
+#include "preprocessor.h"
+#include "utils.h"
+#include "cache.h"
+#include "sha256.h"
+#include "expression.h"
+#include "stats.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <regex>
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+#include <cstdint>
+#include <limits>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+
+namespace
+{
+    // Cache de INCLUDEs já analisados, por hash do conteúdo: em memória para o processo
+    // inteiro e, com MONTADOR_CACHE definido, também em disco entre execuções
+    std::mutex includeCacheMutex;
+    std::unordered_map<std::string, ParsedSource> includeCache;
+
+    BuildCache *diskCache()
+    {
+        static std::unique_ptr<BuildCache> cache = BuildCache::fromEnvironment();
+        return cache.get();
+    }
+
+    void putNumber(std::string &data, uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i)
+            data.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+
+    const int maximumMacroDepth = 64;
+
+    // Separa uma linha em tokens, guardando se cada um veio depois de espaço ou de vírgula
+    std::vector<MacroToken> splitTokens(const std::string &line)
+    {
+        std::vector<MacroToken> tokens;
+        char separator = 0;
+        size_t i = 0;
+        while (i < line.size())
+        {
+            if (line[i] == ' ' || line[i] == '\t' || line[i] == ',')
+            {
+                if (!tokens.empty() && separator != ',')
+                    separator = line[i] == ',' ? ',' : ' ';
+                ++i;
+                continue;
+            }
+            size_t start = i;
+            while (i < line.size() && line[i] != ' ' && line[i] != '\t' && line[i] != ',')
+                ++i;
+            tokens.push_back({line.substr(start, i - start), tokens.empty() ? '\0' : separator, -1});
+            separator = 0;
+        }
+        return tokens;
+    }
+
+    std::string joinTokens(const std::vector<MacroToken> &tokens)
+    {
+        std::string line;
+        for (const auto &token : tokens)
+        {
+            if (token.separator != 0 && !line.empty())
+                line.push_back(token.separator);
+            line += token.text;
+        }
+        return line;
+    }
+
+    enum class Directive
+    {
+        None,
+        If,
+        Else,
+        EndIf
+    };
+
+    // Primeira palavra da linha, sem diferenciar maiúsculas, para reconhecer IF/ELSE/ENDIF
+    Directive directiveOf(const std::string &word)
+    {
+        if (word.size() < 2 || word.size() > 5)
+            return Directive::None;
+        std::string upper = word;
+        for (auto &ch : upper)
+            ch = static_cast<char>(std::toupper(static_cast<unsigned char>(ch)));
+        if (upper == "IF")
+            return Directive::If;
+        if (upper == "ELSE")
+            return Directive::Else;
+        if (upper == "ENDIF")
+            return Directive::EndIf;
+        return Directive::None;
+    }
+
+    Directive lineDirective(const std::string &line)
+    {
+        size_t start = line.find_first_not_of(' ');
+        if (start == std::string::npos)
+            return Directive::None;
+        return directiveOf(line.substr(start, line.find(' ', start) - start));
+    }
+
+    // Texto depois de "IF"
+    std::string conditionOf(const std::string &line)
+    {
+        size_t start = line.find_first_not_of(' ') + 2;
+        size_t first = line.find_first_not_of(' ', start);
+        return first == std::string::npos ? "" : line.substr(first);
+    }
+
+    // Para cada IF de bloco, a posição do ELSE (ou do ENDIF) e a do ENDIF; npos num IF de uma
+    // linha, que vale só para o comando seguinte (uma linha ou um bloco IF...ENDIF inteiro)
+    struct Conditionals
+    {
+        std::vector<size_t> elseOf;
+        std::vector<size_t> endOf;
+    };
+
+    template <typename DirectiveAt>
+    Conditionals matchConditionals(size_t count, DirectiveAt directiveAt)
+    {
+        Conditionals match{std::vector<size_t>(count, std::string::npos), std::vector<size_t>(count, std::string::npos)};
+        std::vector<size_t> open;
+        for (size_t i = 0; i < count; ++i)
+        {
+            Directive directive = directiveAt(i);
+            if (directive == Directive::If)
+            {
+                open.push_back(i);
+            }
+            else if (directive == Directive::Else)
+            {
+                if (open.empty() || match.elseOf[open.back()] != std::string::npos)
+                    throw std::runtime_error("Error: ELSE without IF");
+                match.elseOf[open.back()] = i;
+            }
+            else if (directive == Directive::EndIf)
+            {
+                if (open.empty())
+                    throw std::runtime_error("Error: ENDIF without IF");
+                match.endOf[open.back()] = i;
+                if (match.elseOf[open.back()] == std::string::npos)
+                    match.elseOf[open.back()] = i;
+                open.pop_back();
+            }
+        }
+        // IFs que ficaram abertos são de uma linha; um ELSE encontrado para eles é inválido
+        for (size_t index : open)
+        {
+            if (match.elseOf[index] != std::string::npos)
+                throw std::runtime_error("Error: ELSE without ENDIF");
+        }
+        return match;
+    }
+
+    // Uma posição após o comando que começa em index; span dá o fim de um comando comum
+    template <typename DirectiveAt, typename Span>
+    size_t statementEnd(const Conditionals &match, size_t index, size_t end, DirectiveAt directiveAt, Span span)
+    {
+        if (directiveAt(index) != Directive::If)
+            return span(index);
+        if (match.endOf[index] != std::string::npos)
+            return match.endOf[index] + 1;
+        if (index + 1 >= end)
+            throw std::runtime_error("Error: No line following IF directive.");
+        return statementEnd(match, index + 1, end, directiveAt, span);
+    }
+
+    // Percorre [begin, end) avaliando cada IF ao alcançá-lo; regiões falsas são puladas sem
+    // que visit veja nada delas, então nenhum INCLUDE, macro ou EQU ali dentro é tratado
+    template <typename DirectiveAt, typename Span, typename Condition, typename Visit>
+    void walkConditionals(const Conditionals &match, size_t begin, size_t end, DirectiveAt directiveAt, Span span,
+                          Condition condition, Visit visit)
+    {
+        size_t i = begin;
+        while (i < end)
+        {
+            if (directiveAt(i) != Directive::If)
+            {
+                visit(i);
+                i = span(i);
+                continue;
+            }
+
+            bool taken = condition(i);
+            if (match.endOf[i] != std::string::npos)
+            {
+                if (taken)
+                    walkConditionals(match, i + 1, match.elseOf[i], directiveAt, span, condition, visit);
+                else if (match.elseOf[i] != match.endOf[i])
+                    walkConditionals(match, match.elseOf[i] + 1, match.endOf[i], directiveAt, span, condition, visit);
+                i = match.endOf[i] + 1;
+            }
+            else
+            {
+                size_t next = statementEnd(match, i, end, directiveAt, span);
+                if (taken)
+                    walkConditionals(match, i + 1, next, directiveAt, span, condition, visit);
+                i = next;
+            }
+        }
+    }
+
+    bool getNumber(const std::string &data, size_t &offset, uint32_t &value)
+    {
+        if (offset + 4 > data.size())
+            return false;
+        value = 0;
+        for (int i = 0; i < 4; ++i)
+            value |= static_cast<uint32_t>(static_cast<unsigned char>(data[offset + i])) << (8 * i);
+        offset += 4;
+        return true;
+    }
+}
+
+// Formato binário: "PPI4", número de itens e, por item, tipo (1 byte), linha e os dois textos com seus tamanhos
+std::string ParsedSource::serialize() const
+{
+    std::string data = "PPI4";
+    putNumber(data, static_cast<uint32_t>(items.size()));
+    for (const auto &item : items)
+    {
+        data.push_back(item.kind);
+        putNumber(data, static_cast<uint32_t>(item.line));
+        putNumber(data, static_cast<uint32_t>(item.text.size()));
+        data += item.text;
+        putNumber(data, static_cast<uint32_t>(item.expression.size()));
+        data += item.expression;
+    }
+    return data;
+}
+
+bool ParsedSource::deserialize(const std::string &data, ParsedSource &parsed)
+{
+    size_t offset = 4;
+    uint32_t count;
+    if (data.compare(0, 4, "PPI4") != 0 || !getNumber(data, offset, count))
+        return false;
+    parsed.items.clear();
+    parsed.items.reserve(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (offset >= data.size())
+            return false;
+        Item item;
+        item.kind = static_cast<Kind>(data[offset++]);
+        uint32_t line, size;
+        if (!getNumber(data, offset, line))
+            return false;
+        item.line = line;
+        if (!getNumber(data, offset, size) || offset + size > data.size())
+            return false;
+        item.text = data.substr(offset, size);
+        offset += size;
+        if (!getNumber(data, offset, size) || offset + size > data.size())
+            return false;
+        item.expression = data.substr(offset, size);
+        offset += size;
+        parsed.items.push_back(std::move(item));
+    }
+    return offset == data.size();
+}
+
+void Preprocessor::preprocess(const std::string &inputFile, const std::string &outputFile)
+{
+        std::ifstream input(inputFile);
+        std::ofstream output(outputFile);
+        setIncludeDirectory(std::filesystem::path(inputFile).parent_path().string());
+        preprocess(input, output);
+}
+
+// INCLUDE "arquivo" é relativo a este diretório (no arquivo principal) ou ao do arquivo que inclui
+void Preprocessor::setIncludeDirectory(const std::string &directory)
+{
+        includeDirectory = directory.empty() ? "." : directory;
+}
+
+const std::vector<std::string> &Preprocessor::getIncludedFiles() const
+{
+        return includedFiles;
+}
+
+// Saídas de fontes com INCLUDE dependem de outros arquivos e não podem ser guardadas só pelo conteúdo do fonte
+bool Preprocessor::hasIncludes(const std::string &source)
+{
+        static const std::regex includeRegex("\\bINCLUDE\\b", std::regex_constants::icase);
+        return std::regex_search(source, includeRegex);
+}
+
+// Remove comentários e espaços e separa EQUs, INCLUDEs e condicionais das demais linhas
+ParsedSource Preprocessor::parse(std::istream &input)
+{
+        static const std::regex macroRegex("^ ?[A-Za-z_][A-Za-z0-9_]*: ?MACRO\\b.*$", std::regex_constants::icase);
+        static const std::regex endMacroRegex("^ ?ENDMACRO ?$", std::regex_constants::icase);
+        ParsedSource parsed;
+        std::string line;
+        size_t number = 0;
+        bool insideMacro = false;
+        while (std::getline(input, line))
+        {
+            ++number;
+            line = removeComments(line);
+            line = removeExtraSpaces(line);
+            if (line.empty())
+                continue;
+
+            size_t first = parsed.items.size();
+
+            // O corpo da macro é guardado como está: EQU e INCLUDE valem só onde ela for expandida
+            if (std::regex_match(line, endMacroRegex))
+            {
+                if (!insideMacro)
+                    throw std::runtime_error("Error: ENDMACRO without MACRO");
+                parsed.items.push_back({ParsedSource::EndMacro, "", ""});
+                insideMacro = false;
+            }
+            else if (insideMacro)
+            {
+                parsed.items.push_back({ParsedSource::Line, line, ""});
+            }
+            else if (std::regex_match(line, macroRegex))
+            {
+                parsed.items.push_back({ParsedSource::Macro, line, ""});
+                insideMacro = true;
+            }
+            else if (Directive directive = lineDirective(line); directive != Directive::None)
+            {
+                if (directive == Directive::If)
+                    parsed.items.push_back({ParsedSource::If, "", conditionOf(line)});
+                else
+                    parsed.items.push_back({directive == Directive::Else ? ParsedSource::Else : ParsedSource::EndIf, "", ""});
+            }
+            else if (!parseDirective(line, number, parsed.items))
+            {
+                parsed.items.push_back({ParsedSource::Line, line, ""});
+            }
+            for (size_t i = first; i < parsed.items.size(); ++i)
+                parsed.items[i].line = number;
+        }
+        if (insideMacro)
+            throw std::runtime_error("Error: MACRO without ENDMACRO");
+        return parsed;
+}
+
+// Linha de EQU ou INCLUDE vira item; um EQU sem rótulo não gera nenhum
+bool Preprocessor::parseDirective(const std::string &line, size_t number, std::vector<ParsedSource::Item> &items)
+{
+        static const std::regex equRegex("\\bEQU\\b", std::regex_constants::icase);
+        static const std::regex includeRegex("^ ?INCLUDE \"([^\"]+)\" ?$", std::regex_constants::icase);
+        std::smatch match;
+        if (std::regex_search(line, equRegex))
+        {
+            std::string name, expression;
+            if (processEqu(line, name, expression))
+                items.push_back({ParsedSource::Equ, name, expression, number});
+            return true;
+        }
+        if (std::regex_match(line, match, includeRegex))
+        {
+            items.push_back({ParsedSource::Include, match[1].str(), "", number});
+            return true;
+        }
+        return false;
+}
+
+const ParsedSource &Preprocessor::loadInclude(const std::string &path, const std::string &content)
+{
+        std::string key = Sha256::hex(content);
+        {
+            std::lock_guard<std::mutex> lock(includeCacheMutex);
+            auto it = includeCache.find(key);
+            if (it != includeCache.end())
+                return it->second;
+        }
+
+        ParsedSource parsed;
+        BuildCache *cache = diskCache();
+        std::string cacheKey = BuildCache::key("include", "", {content});
+        std::string data;
+        if (cache == nullptr || !cache->lookup(cacheKey, data) || !ParsedSource::deserialize(data, parsed))
+        {
+            std::istringstream input(content);
+            try
+            {
+                parsed = parse(input);
+            }
+            catch (const std::runtime_error &e)
+            {
+                throw std::runtime_error(std::string(e.what()) + " (in " + path + ")");
+            }
+            if (cache != nullptr)
+                cache->store(cacheKey, parsed.serialize());
+        }
+
+        std::lock_guard<std::mutex> lock(includeCacheMutex);
+        return includeCache.emplace(key, std::move(parsed)).first->second;
+}
+
+// Junta EQUs e linhas, entrando nos INCLUDEs recursivamente. Os condicionais são avaliados
+// aqui, na ordem do fonte, e casados dentro de cada arquivo: um bloco IF termina no mesmo arquivo
+void Preprocessor::expand(const ParsedSource &parsed, const std::string &directory, std::vector<std::string> &lines)
+{
+        const auto &items = parsed.items;
+        auto directiveAt = [&items](size_t index)
+        {
+            switch (items[index].kind)
+            {
+            case ParsedSource::If:
+                return Directive::If;
+            case ParsedSource::Else:
+                return Directive::Else;
+            case ParsedSource::EndIf:
+                return Directive::EndIf;
+            default:
+                return Directive::None;
+            }
+        };
+        // Uma definição de macro é um só comando, até o ENDMACRO
+        auto span = [&items](size_t index)
+        {
+            if (items[index].kind != ParsedSource::Macro)
+                return index + 1;
+            while (++index < items.size() && items[index].kind != ParsedSource::EndMacro)
+                ;
+            return index + 1;
+        };
+        auto condition = [this, &items](size_t index)
+        { return evaluateCondition(items[index].expression); };
+
+        Conditionals match = matchConditionals(items.size(), directiveAt);
+        walkConditionals(match, 0, items.size(), directiveAt, span, condition, [&](size_t index)
+                         { expandItem(parsed, index, directory, lines); });
+}
+
+void Preprocessor::expandItem(const ParsedSource &parsed, size_t index, const std::string &directory, std::vector<std::string> &lines)
+{
+        const ParsedSource::Item &item = parsed.items[index];
+        if (item.kind == ParsedSource::Line)
+        {
+            if (macros.empty() || !expandMacro(splitTokens(item.text), directory, lines, 0))
+                lines.push_back(item.text);
+            return;
+        }
+        if (item.kind == ParsedSource::Macro)
+        {
+            std::vector<ParsedSource::Item> body;
+            while (++index < parsed.items.size() && parsed.items[index].kind != ParsedSource::EndMacro)
+                body.push_back(parsed.items[index]);
+            defineMacro(item.text, body);
+            return;
+        }
+        if (item.kind == ParsedSource::Equ)
+        {
+            // Redefinição invalida valores já memorizados que possam depender do antigo
+            if (!equExpressions.insert_or_assign(item.text, item.expression).second)
+                equValues.clear();
+            equLines[item.text] = item.line;
+            return;
+        }
+
+        std::filesystem::path target = std::filesystem::path(directory) / item.text;
+        std::string path = std::filesystem::absolute(target).lexically_normal().string();
+        if (std::find(includeStack.begin(), includeStack.end(), path) != includeStack.end())
+        {
+            std::string chain;
+            for (const auto &file : includeStack)
+                chain += file + " -> ";
+            throw std::runtime_error("Error: Circular include: " + chain + path);
+        }
+        if (!included.insert(path).second)
+            return; // Já incluído nesta unidade
+
+        std::ifstream input(path);
+        if (!input)
+            throw std::runtime_error("Error: Could not open include file: " + item.text);
+        std::stringstream content;
+        content << input.rdbuf();
+        includedFiles.push_back(path);
+
+        includeStack.push_back(path);
+        expand(loadInclude(path, content.str()), std::filesystem::path(path).parent_path().string(), lines);
+        includeStack.pop_back();
+}
+
+// "NOME: MACRO &A, &B": cada linha do corpo vira tokens, e cada &A uma posição de parâmetro
+void Preprocessor::defineMacro(const std::string &header, const std::vector<ParsedSource::Item> &body)
+{
+        std::vector<MacroToken> tokens = splitTokens(header);
+        std::string name = tokens[0].text.substr(0, tokens[0].text.find(':'));
+        size_t first = tokens[0].text.back() == ':' ? 2 : 1; // "NOME: MACRO" ou "NOME:MACRO"
+        std::unordered_map<std::string, int> parameters;
+        for (size_t i = first; i < tokens.size(); ++i)
+        {
+            if (tokens[i].text.size() < 2 || tokens[i].text[0] != '&')
+                throw std::runtime_error("Error: Invalid macro parameter: " + tokens[i].text);
+            if (!parameters.emplace(tokens[i].text, static_cast<int>(parameters.size())).second)
+                throw std::runtime_error("Error: Duplicate macro parameter: " + tokens[i].text);
+        }
+
+        MacroTemplate macro{parameters.size(), {}, {}};
+        std::vector<ParsedSource::Item> probe;
+        for (const auto &line : body)
+        {
+            macro.directives.push_back(parseDirective(line.text, line.line, probe) ? line.line : 0);
+            std::vector<MacroToken> lineTokens = splitTokens(line.text);
+            for (auto &token : lineTokens)
+            {
+                bool label = token.text.size() > 1 && token.text.back() == ':';
+                auto it = parameters.find(label ? token.text.substr(0, token.text.size() - 1) : token.text);
+                if (it != parameters.end())
+                {
+                    token.parameter = it->second;
+                    token.text = label ? ":" : "";
+                }
+            }
+            macro.lines.push_back(std::move(lineTokens));
+        }
+        if (!macros.emplace(name, std::move(macro)).second)
+            throw std::runtime_error("Error: Redefinition of macro: " + name);
+}
+
+// Expande a linha se ela chama uma macro; os argumentos (separados por vírgula) são trechos de
+// tokens copiados para as posições de parâmetro, e chamadas aninhadas seguem como tokens.
+// EQU e INCLUDE do corpo são tratados como no nível de cima, relativos a directory
+bool Preprocessor::expandMacro(const std::vector<MacroToken> &tokens, const std::string &directory, std::vector<std::string> &lines, int depth)
+{
+        size_t nameIndex = !tokens.empty() && tokens[0].text.back() == ':' ? 1 : 0;
+        if (nameIndex >= tokens.size())
+            return false;
+        auto it = macros.find(tokens[nameIndex].text);
+        if (it == macros.end())
+            return false;
+        if (depth >= maximumMacroDepth)
+            throw std::runtime_error("Error: Macro expansion too deep: " + tokens[nameIndex].text);
+        const MacroTemplate &macro = it->second;
+
+        // Rótulo da chamada marca a primeira palavra da expansão
+        if (nameIndex == 1)
+            lines.push_back(tokens[0].text);
+
+        std::vector<std::pair<size_t, size_t>> arguments; // [início, fim) em tokens
+        for (size_t i = nameIndex + 1; i < tokens.size(); ++i)
+        {
+            if (arguments.empty() || tokens[i].separator == ',')
+                arguments.push_back({i, i + 1});
+            else
+                arguments.back().second = i + 1;
+        }
+        if (arguments.size() != macro.parameters)
+            throw std::runtime_error("Error: Macro " + tokens[nameIndex].text + " expects " + std::to_string(macro.parameters) +
+                                     " arguments, got " + std::to_string(arguments.size()));
+
+        std::vector<std::vector<MacroToken>> expansion(macro.lines.size());
+        for (size_t index = 0; index < macro.lines.size(); ++index)
+        {
+            std::vector<MacroToken> &line = expansion[index];
+            for (const auto &token : macro.lines[index])
+            {
+                if (token.parameter < 0)
+                {
+                    line.push_back(token);
+                    continue;
+                }
+                auto [begin, end] = arguments[token.parameter];
+                line.insert(line.end(), tokens.begin() + begin, tokens.begin() + end);
+                line[line.size() - (end - begin)].separator = token.separator;
+                line.back().text += token.text;
+            }
+        }
+
+        // IF no corpo é avaliado depois da troca dos parâmetros, a cada expansão
+        auto directiveAt = [&expansion](size_t index)
+        { return expansion[index].empty() ? Directive::None : directiveOf(expansion[index][0].text); };
+        auto span = [](size_t index)
+        { return index + 1; };
+        auto condition = [this, &expansion](size_t index)
+        { return evaluateCondition(joinTokens(std::vector<MacroToken>(expansion[index].begin() + 1, expansion[index].end()))); };
+        Conditionals match = matchConditionals(expansion.size(), directiveAt);
+        walkConditionals(match, 0, expansion.size(), directiveAt, span, condition, [&](size_t index)
+                         {
+                             if (macro.directives[index] != 0)
+                             {
+                                 ParsedSource directive;
+                                 parseDirective(joinTokens(expansion[index]), macro.directives[index], directive.items);
+                                 for (size_t item = 0; item < directive.items.size(); ++item)
+                                     expandItem(directive, item, directory, lines);
+                             }
+                             else if (!expandMacro(expansion[index], directory, lines, depth + 1))
+                                 lines.push_back(joinTokens(expansion[index])); });
+        return true;
+}
+
+void Preprocessor::preprocess(std::istream &input, std::ostream &output)
+{
+        ScopedTimer timer("preprocess");
+        std::vector<std::string> lines;
+        includeStack.clear();
+        included.clear();
+        includedFiles.clear();
+        macros.clear();
+        equExpressions.clear();
+        equLines.clear();
+        equValues.clear();
+        equStack.clear();
+
+        // Um passo só: INCLUDEs, macros e EQUs na ordem do fonte, com IF/ELSE/ENDIF avaliados ao
+        // serem alcançados; o que está numa região falsa não é lido nem guardado
+        expand(parse(input), includeDirectory, lines);
+
+        // Avalia todos os EQUs; cada um resolve antes as suas dependências
+        for (const auto &[name, expression] : equExpressions)
+            equValue(name);
+
+        for (const auto &line : lines)
+            output << replaceEqu(line) << std::endl;
+        Stats::count("preprocessed_lines", static_cast<long>(lines.size()));
+}
+
+// "ROTULO: EQU expressão"
+bool Preprocessor::processEqu(const std::string &line, std::string &name, std::string &expression)
+{
+        size_t colon = line.find(':');
+        if (colon == std::string::npos)
+            return false;
+        name = removeExtraSpaces(line.substr(0, colon));
+        name.erase(0, name.find_first_not_of(' '));
+        name.erase(name.find_last_not_of(' ') + 1);
+
+        std::istringstream iss(line.substr(colon + 1));
+        std::string equ;
+        iss >> equ;
+        std::getline(iss, expression);
+        expression.erase(0, expression.find_first_not_of(' '));
+        if (expression.empty())
+            throw std::runtime_error("Error: Missing value for EQU: " + name);
+        return !name.empty();
+}
+
+// Avaliação memorizada em ordem de dependência; um EQU que depende de si mesmo é erro
+int Preprocessor::equValue(const std::string &name)
+{
+        auto value = equValues.find(name);
+        if (value != equValues.end())
+            return value->second;
+        auto definition = equExpressions.find(name);
+        if (definition == equExpressions.end())
+            throw std::runtime_error("Error: Undefined symbol in constant expression: " + name);
+        if (std::find(equStack.begin(), equStack.end(), name) != equStack.end())
+        {
+            std::string chain;
+            for (const auto &symbol : equStack)
+                chain += symbol + " -> ";
+            throw std::runtime_error("Error: Circular EQU definition: " + chain + name);
+        }
+
+        equStack.push_back(name);
+        long long result = Expression::evaluate(definition->second, [this](const std::string &symbol)
+                                                { return static_cast<long long>(equValue(symbol)); });
+        equStack.pop_back();
+        if (result < std::numeric_limits<int>::min() || result > std::numeric_limits<int>::max())
+            throw std::runtime_error("Error: Value out of range for EQU " + name + " at line " + std::to_string(equLines[name]) + ": " +
+                                     std::to_string(result));
+        equValues[name] = static_cast<int>(result);
+        return static_cast<int>(result);
+}
+
+// Substitui nomes inteiros de EQU pelo seu valor
+std::string Preprocessor::replaceEqu(const std::string &line)
+{
+    if (equValues.empty())
+        return line;
+    auto isName = [&line](size_t index)
+    { return index < line.size() && (std::isalnum(static_cast<unsigned char>(line[index])) || line[index] == '_'); };
+    std::string result;
+    size_t i = 0;
+    while (i < line.size())
+    {
+        size_t start = i;
+        if (!isName(i))
+        {
+            result.push_back(line[i++]);
+            continue;
+        }
+        while (isName(i))
+            ++i;
+        if (std::isdigit(static_cast<unsigned char>(line[start])))
+        {
+            result.append(line, start, i - start); // Número, não nome
+            continue;
+        }
+        auto it = equValues.find(line.substr(start, i - start));
+        if (it != equValues.end())
+            result += std::to_string(it->second);
+        else
+            result.append(line, start, i - start);
+    }
+    return result;
+}
+
+// Só EQUs definidos antes do IF, na ordem do fonte, podem aparecer na condição
+bool Preprocessor::evaluateCondition(const std::string &condition)
+{
+        if (condition.empty())
+            throw std::runtime_error("Error: Invalid condition in IF directive: " + condition);
+        try
+        {
+            return Expression::evaluate(condition, [this](const std::string &symbol)
+                                        { return static_cast<long long>(equValue(symbol)); }) != 0;
+        }
+        catch (const std::runtime_error &e)
+        {
+            throw std::runtime_error("Error: Invalid condition in IF directive: " + condition + " (" + e.what() + ")");
+        }
+}
+
+std::string Preprocessor::removeComments(const std::string &line)
+{
+    return Utils::removeComments(line);
+}
+
+std::string Preprocessor::removeExtraSpaces(const std::string &line)
+{
+    return Utils::removeExtraSpaces(line);
+}
@@ -1,21 +1,89 @@
-#ifndef PREPROCESSOR_H
-#define PREPROCESSOR_H
-
-#include <string>
-#include <unordered_map>
-#include <fstream>
-
-class Preprocessor
-{
-public:
-    void preprocess(const std::string &inputFile, const std::string &outputFile);
-
-private:
-    void processEqu(const std::string &line, std::unordered_map<std::string, int> &equMap);
-    std::string replaceEqu(const std::string &line, const std::unordered_map<std::string, int> &equMap);
-    void processIf(const std::string &line, const std::unordered_map<std::string, int> &equMap, std::ofstream &output, const std::string &nextLine);
-    std::string removeComments(const std::string &line);
-    std::string removeExtraSpaces(const std::string &line);
-};
-
-#endif // PREPROCESSOR_H
+#ifndef PREPROCESSOR_H
+#define PREPROCESSOR_H
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <fstream>
+
+// Conteúdo de um arquivo já analisado: linhas limpas, EQUs, INCLUDEs e condicionais na ordem do fonte
+struct ParsedSource
+{
+    enum Kind : char
+    {
+        Line,
+        Equ,
+        Include,
+        Macro,   // Cabeçalho "NOME: MACRO &A, &B"; as linhas seguintes até EndMacro são o corpo
+        EndMacro,
+        If,      // Condição em expression
+        Else,
+        EndIf
+    };
+    struct Item
+    {
+        Kind kind;
+        std::string text;       // Linha, nome do EQU ou caminho incluído
+        std::string expression; // Expressão do EQU ou condição do IF
+        size_t line = 0;        // Linha no arquivo, 1 em diante
+    };
+    std::vector<Item> items;
+
+    std::string serialize() const;
+    static bool deserialize(const std::string &data, ParsedSource &parsed);
+};
+
+// Token de uma linha de macro; parameter >= 0 marca a posição a preencher com o argumento
+// (text guarda então só o sufixo, como o ':' de um rótulo)
+struct MacroToken
+{
+    std::string text;
+    char separator; // ' ' ou ',' antes do token; 0 no primeiro
+    int parameter;
+};
+
+// Corpo de macro separado em tokens uma única vez, na definição
+struct MacroTemplate
+{
+    size_t parameters;
+    std::vector<std::vector<MacroToken>> lines;
+    std::vector<size_t> directives; // Linha no fonte das linhas de EQU ou INCLUDE, tratadas a cada expansão; 0 nas demais
+};
+
+class Preprocessor
+{
+public:
+    void preprocess(const std::string &inputFile, const std::string &outputFile);
+    void preprocess(std::istream &input, std::ostream &output);
+    void setIncludeDirectory(const std::string &directory);
+    const std::vector<std::string> &getIncludedFiles() const;
+    static bool hasIncludes(const std::string &source);
+
+private:
+    ParsedSource parse(std::istream &input);
+    const ParsedSource &loadInclude(const std::string &path, const std::string &content);
+    void expand(const ParsedSource &parsed, const std::string &directory, std::vector<std::string> &lines);
+    void expandItem(const ParsedSource &parsed, size_t index, const std::string &directory, std::vector<std::string> &lines);
+    void defineMacro(const std::string &header, const std::vector<ParsedSource::Item> &body);
+    bool expandMacro(const std::vector<MacroToken> &tokens, const std::string &directory, std::vector<std::string> &lines, int depth);
+    bool parseDirective(const std::string &line, size_t number, std::vector<ParsedSource::Item> &items);
+    bool processEqu(const std::string &line, std::string &name, std::string &expression);
+    int equValue(const std::string &name);
+    std::string replaceEqu(const std::string &line);
+    bool evaluateCondition(const std::string &condition);
+    std::string removeComments(const std::string &line);
+    std::string removeExtraSpaces(const std::string &line);
+
+    std::string includeDirectory = ".";
+    std::vector<std::string> includeStack;   // Detecção de ciclos
+    std::unordered_set<std::string> included; // Guarda: cada arquivo entra uma vez por unidade
+    std::vector<std::string> includedFiles;
+    std::unordered_map<std::string, MacroTemplate> macros;
+    std::unordered_map<std::string, std::string> equExpressions;
+    std::unordered_map<std::string, size_t> equLines;
+    std::unordered_map<std::string, int> equValues; // Memorizados: cada EQU é avaliado uma vez
+    std::vector<std::string> equStack;              // EQUs em avaliação, para detectar ciclos
+};
+
+#endif // PREPROCESSOR_H
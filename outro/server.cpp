@@ -0,0 +1,391 @@
+#include "server.h"
+#include "assembler.h"
+#include "preprocessor.h"
+#include "linker.h"
+#include "simulator.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+    const size_t maximumCacheBytes = 64 * 1024 * 1024;
+    const size_t maximumInputBytes = 64 * 1024 * 1024; // Soma dos tamanhos inline de uma requisição
+    const size_t maximumLatencySamples = 4096;         // Por tipo de requisição
+    const int connectionTimeoutSeconds = 10;            // Conexão ociosa não segura um worker
+
+    std::string readFile(const std::string &path)
+    {
+        std::ifstream input(path);
+        if (!input)
+            throw std::runtime_error("Error: Could not open input file: " + path);
+        std::stringstream content;
+        content << input.rdbuf();
+        return content.str();
+    }
+}
+
+Server::Server(const std::string &socketPath, unsigned threads)
+    : socketPath(socketPath), threads(std::max(1u, threads))
+{
+}
+
+bool Server::readLine(int fd, std::string &line, size_t maximumLength)
+{
+    line.clear();
+    char ch;
+    while (true)
+    {
+        ssize_t count = ::read(fd, &ch, 1);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            return false;
+        if (ch == '\n')
+            return true;
+        if (line.size() == maximumLength)
+            throw std::runtime_error("Error: Request header longer than " + std::to_string(maximumLength) + " bytes");
+        line.push_back(ch);
+    }
+}
+
+bool Server::readBytes(int fd, size_t count, std::string &data)
+{
+    data.resize(count);
+    size_t done = 0;
+    while (done < count)
+    {
+        ssize_t received = ::read(fd, &data[done], count - done);
+        if (received <= 0)
+            return false;
+        done += received;
+    }
+    return true;
+}
+
+bool Server::writeAll(int fd, const std::string &data)
+{
+    size_t done = 0;
+    while (done < data.size())
+    {
+        ssize_t sent = ::send(fd, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+            continue;
+        if (sent <= 0)
+            return false; // EPIPE: o cliente já fechou a conexão
+        done += sent;
+    }
+    return true;
+}
+
+std::string Server::request(const std::string &socketPath, const std::string &type, const std::vector<std::string> &inputs)
+{
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    socketPath.copy(address.sun_path, sizeof(address.sun_path) - 1);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0)
+    {
+        if (fd >= 0)
+            ::close(fd);
+        throw std::runtime_error("Error: Could not connect to " + socketPath);
+    }
+
+    std::string header = type + " inline";
+    std::string payload;
+    for (const auto &input : inputs)
+    {
+        header += " " + std::to_string(input.size());
+        payload += input;
+    }
+    writeAll(fd, header + "\n" + payload);
+
+    std::string status, response;
+    if (!readLine(fd, status))
+    {
+        ::close(fd);
+        throw std::runtime_error("Error: No response from server");
+    }
+    std::istringstream fields(status);
+    std::string result;
+    size_t size = 0;
+    fields >> result >> size;
+    bool complete = readBytes(fd, size, response);
+    ::close(fd);
+    if (!complete)
+        throw std::runtime_error("Error: Truncated response from server");
+    if (result != "OK")
+        throw std::runtime_error(response);
+    return response;
+}
+
+void Server::run()
+{
+    // Aquece as tabelas estáticas do montador antes da primeira requisição
+    Assembler warmup;
+    warmup.assembleObject("L: LOAD X\nJMP L\nX: CONST 1\n");
+
+    int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0)
+        throw std::runtime_error("Error: Could not create socket");
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path))
+        throw std::runtime_error("Error: Socket path too long: " + socketPath);
+    std::copy(socketPath.begin(), socketPath.end(), address.sun_path);
+    ::unlink(socketPath.c_str());
+    if (::bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || ::listen(listener, 64) < 0)
+        throw std::runtime_error("Error: Could not listen on " + socketPath);
+
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < threads; ++i)
+        pool.emplace_back(&Server::worker, this);
+
+    while (true)
+    {
+        int fd = ::accept(listener, nullptr, nullptr);
+        if (fd < 0)
+            continue;
+        timeval timeout{connectionTimeoutSeconds, 0};
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            connections.push(fd);
+        }
+        queueReady.notify_one();
+    }
+}
+
+void Server::worker()
+{
+    while (true)
+    {
+        int fd;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueReady.wait(lock, [this]
+                            { return !connections.empty(); });
+            fd = connections.front();
+            connections.pop();
+        }
+        handleConnection(fd);
+        ::close(fd);
+    }
+}
+
+void Server::handleConnection(int fd)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::string header;
+    try
+    {
+        if (!readLine(fd, header))
+            return;
+    }
+    catch (const std::exception &e)
+    {
+        // O resto da linha não é lido: a resposta sai e a conexão é fechada
+        std::string message = e.what();
+        writeAll(fd, "ERROR " + std::to_string(message.size()) + "\n" + message);
+        return;
+    }
+
+    std::istringstream fields(header);
+    std::string type, mode, argument;
+    fields >> type >> mode;
+    std::vector<std::string> arguments;
+    while (fields >> argument)
+        arguments.push_back(argument);
+
+    std::string status = "OK";
+    std::string response;
+    try
+    {
+        std::vector<std::string> inputs;
+        if (mode == "inline")
+        {
+            // Confere todos os tamanhos antes de alocar qualquer entrada
+            std::vector<size_t> sizes;
+            size_t total = 0;
+            for (const auto &size : arguments)
+            {
+                if (size.empty() || size.size() > 19 || size.find_first_not_of("0123456789") != std::string::npos)
+                    throw std::runtime_error("Error: Invalid inline size: " + size);
+                sizes.push_back(std::stoull(size));
+                total += sizes.back();
+                if (total > maximumInputBytes)
+                    throw std::runtime_error("Error: Inline input larger than " + std::to_string(maximumInputBytes) + " bytes");
+            }
+            for (size_t size : sizes)
+            {
+                std::string data;
+                if (!readBytes(fd, size, data))
+                    return;
+                inputs.push_back(data);
+            }
+        }
+        else if (mode == "path")
+        {
+            for (const auto &path : arguments)
+                inputs.push_back(readFile(path));
+            if (type == "preprocess" && arguments.size() == 1)
+                inputs.push_back(std::filesystem::absolute(arguments[0]).parent_path().string());
+        }
+        else if (type != "stats")
+        {
+            throw std::runtime_error("Error: Unknown input mode: " + mode);
+        }
+
+        if (type == "stats")
+        {
+            response = statistics();
+        }
+        else
+        {
+            // A chave do cache é a requisição completa: tipo e conteúdo das entradas
+            std::string key = type;
+            for (const auto &input : inputs)
+                key += '\0' + std::to_string(input.size()) + '\0' + input;
+
+            // Pré-processamento com INCLUDE depende de arquivos fora da requisição
+            bool cacheable = type != "preprocess" || inputs.empty() || !Preprocessor::hasIncludes(inputs[0]);
+            bool hit = false;
+            if (cacheable)
+            {
+                std::lock_guard<std::mutex> lock(cacheMutex);
+                auto it = cache.find(key);
+                if (it != cache.end())
+                {
+                    response = it->second;
+                    cacheHits++;
+                    hit = true;
+                }
+            }
+            if (!hit)
+            {
+                response = execute(type, inputs);
+            }
+            if (!hit && cacheable)
+            {
+                std::lock_guard<std::mutex> lock(cacheMutex);
+                if (cacheBytes + key.size() + response.size() > maximumCacheBytes)
+                {
+                    cache.clear();
+                    cacheBytes = 0;
+                }
+                cacheBytes += key.size() + response.size();
+                cache.emplace(std::move(key), response);
+            }
+        }
+    }
+    catch (const std::exception &e)
+    {
+        status = "ERROR";
+        response = e.what();
+    }
+
+    writeAll(fd, status + " " + std::to_string(response.size()) + "\n" + response);
+    recordLatency(type, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+}
+
+std::string Server::execute(const std::string &type, const std::vector<std::string> &inputs)
+{
+    if (type == "preprocess" && (inputs.empty() || inputs.size() > 2))
+        throw std::runtime_error("Error: preprocess takes a source and optionally its directory");
+    if (type == "assemble" && inputs.size() != 1)
+        throw std::runtime_error("Error: " + type + " takes exactly one input");
+
+    if (type == "preprocess")
+    {
+        std::istringstream source(inputs[0]);
+        std::ostringstream output;
+        Preprocessor preprocessor;
+        if (inputs.size() > 1)
+            preprocessor.setIncludeDirectory(inputs[1]);
+        preprocessor.preprocess(source, output);
+        return output.str();
+    }
+    if (type == "assemble")
+    {
+        Assembler assembler;
+        ObjectCode object = assembler.assembleObject(inputs[0]);
+        for (const auto &diagnostic : object.diagnostics)
+        {
+            if (diagnostic.isError)
+                throw std::runtime_error(diagnostic.message);
+        }
+        std::ostringstream output;
+        Assembler::writeObject(object, output);
+        return output.str();
+    }
+    if (type == "link")
+    {
+        std::vector<Module> modules;
+        for (size_t i = 0; i < inputs.size(); ++i)
+        {
+            std::istringstream object(inputs[i]);
+            modules.push_back(Linker::readModule(object, "module" + std::to_string(i)));
+        }
+        Linker linker;
+        std::ostringstream output;
+        for (int word : linker.link(modules))
+            output << word << " ";
+        return output.str();
+    }
+    if (type == "run")
+    {
+        if (inputs.empty())
+            throw std::runtime_error("Error: run needs an executable");
+        std::istringstream image(inputs[0]);
+        std::istringstream values(inputs.size() > 1 ? inputs[1] : "");
+        std::ostringstream output;
+        Simulator simulator(Simulator::loadImage(image));
+        simulator.run(values, output);
+        return output.str();
+    }
+    throw std::runtime_error("Error: Unknown request type: " + type);
+}
+
+void Server::recordLatency(const std::string &type, double milliseconds)
+{
+    std::lock_guard<std::mutex> lock(statsMutex);
+    LatencySamples &entry = latencies[type];
+    if (entry.samples.size() < maximumLatencySamples)
+        entry.samples.push_back(milliseconds);
+    else
+        entry.samples[entry.total % maximumLatencySamples] = milliseconds;
+    entry.total++;
+}
+
+// p50/p99 de latência por tipo de requisição, sobre as últimas maximumLatencySamples amostras
+std::string Server::statistics()
+{
+    std::ostringstream output;
+    output << std::fixed << std::setprecision(3);
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        for (const auto &[type, entry] : latencies)
+        {
+            std::vector<double> sorted = entry.samples;
+            std::sort(sorted.begin(), sorted.end());
+            output << type << " count " << entry.total
+                   << " p50 " << sorted[(sorted.size() - 1) * 50 / 100] << " ms"
+                   << " p99 " << sorted[(sorted.size() - 1) * 99 / 100] << " ms" << std::endl;
+        }
+    }
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    output << "cache entries " << cache.size() << " hits " << cacheHits << " bytes " << cacheBytes << std::endl;
+    return output.str();
+}
@@ -0,0 +1,65 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Protocolo (uma requisição por conexão):
+//   <tipo> inline <n1> [<n2> ...]\n seguido de n1 + n2 + ... bytes
+//   <tipo> path <arquivo1> [<arquivo2> ...]\n
+// tipos: preprocess, assemble, link (vários objetos), run (imagem e entradas), stats
+// preprocess inline aceita uma segunda entrada, o diretório (absoluto) do fonte, de onde os
+// INCLUDE são resolvidos; em path mode vale o diretório do arquivo
+// Resposta: "OK <n>\n" ou "ERROR <n>\n" seguido de n bytes
+// Amostras de latência de um tipo: guarda só as últimas, em anel, e conta todas
+struct LatencySamples
+{
+    std::vector<double> samples;
+    size_t total = 0;
+};
+
+class Server
+{
+public:
+    Server(const std::string &socketPath, unsigned threads);
+    void run();
+
+    static const size_t maximumHeaderBytes = 8192; // Linha de cabeçalho, sem o '\n'
+
+    // false se a conexão terminar antes do '\n'; linha maior que maximumLength é erro
+    static bool readLine(int fd, std::string &line, size_t maximumLength = maximumHeaderBytes);
+    static bool readBytes(int fd, size_t count, std::string &data);
+    // Usa send com MSG_NOSIGNAL: cliente que desconecta antes da resposta só derruba a conexão
+    static bool writeAll(int fd, const std::string &data);
+    // Lado do cliente: envia uma requisição inline e devolve a resposta OK (ERROR vira exceção)
+    static std::string request(const std::string &socketPath, const std::string &type, const std::vector<std::string> &inputs);
+
+private:
+    void worker();
+    void handleConnection(int fd);
+    std::string execute(const std::string &type, const std::vector<std::string> &inputs);
+    std::string statistics();
+    void recordLatency(const std::string &type, double milliseconds);
+
+    std::string socketPath;
+    unsigned threads;
+
+    std::mutex queueMutex;
+    std::condition_variable queueReady;
+    std::queue<int> connections;
+
+    std::mutex cacheMutex;
+    std::unordered_map<std::string, std::string> cache; // requisição completa -> resposta
+    size_t cacheBytes = 0;
+    size_t cacheHits = 0;
+
+    std::mutex statsMutex;
+    std::map<std::string, LatencySamples> latencies;
+};
+
+#endif // SERVER_H
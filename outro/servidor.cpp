@@ -0,0 +1,34 @@
+#include <csignal>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "server.h"
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " socket [-t threads]" << std::endl;
+        return 1;
+    }
+
+    unsigned threads = std::thread::hardware_concurrency();
+    if (argc > 3 && std::string(argv[2]) == "-t")
+        threads = std::stoi(argv[3]);
+
+    // Escrever para um cliente que já desconectou não pode encerrar o servidor
+    std::signal(SIGPIPE, SIG_IGN);
+
+    try
+    {
+        Server server(argv[1], threads);
+        server.run();
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,13 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <string>
+#include <string_view>
+
+class Sha256
+{
+public:
+    static std::string hex(std::string_view data);
+};
+
+#endif // SHA256_H
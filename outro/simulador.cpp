@@ -0,0 +1,209 @@
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "executable.h"
+#include "loader.h"
+#include "simulator.h"
+#include "snapshot.h"
+
+namespace
+{
+    struct Placement
+    {
+        std::string file;
+        int base;
+    };
+
+    // Vários executáveis: todos vão para uma única memória, cada um na sua base, e rodam em sequência
+    void runPacked(const std::vector<Placement> &placements, int capacity, const std::string &profileFile)
+    {
+        Loader loader(capacity);
+        for (const auto &placement : placements)
+        {
+            if (Executable::isBinary(placement.file))
+                loader.load(MappedExecutable(placement.file), placement.file, placement.base);
+            else
+                loader.load(Executable::read(placement.file), placement.file, placement.base);
+        }
+        Simulator simulator(loader.memory(), loader.size());
+        for (const auto &program : loader.programs())
+        {
+            simulator.setEntryPoint(program.entry);
+            simulator.run(std::cin, std::cout);
+        }
+        if (!profileFile.empty())
+        {
+            simulator.writeProfile(profileFile);
+        }
+    }
+
+    // Retoma do snapshot; com lines, cada linha da entrada é uma execução independente a partir
+    // do mesmo ponto, e as saídas de execuções seguidas são separadas por uma linha vazia.
+    // O perfil só conta o que roda depois do checkpoint (o snapshot não guarda contagens);
+    // com lines, é a soma das execuções de todas as linhas
+    void runRestored(const std::string &snapshotFile, bool lines, const std::string &profileFile)
+    {
+        Snapshot snapshot = Snapshot::open(snapshotFile);
+        std::vector<long> counts(profileFile.empty() ? 0 : snapshot.header().memoryWords, 0);
+        std::string line;
+        bool first = true;
+        while (!lines || std::getline(std::cin, line))
+        {
+            SnapshotMemory memory = snapshot.restore();
+            Simulator simulator(memory.memory(), memory.words());
+            simulator.setState(snapshot.state());
+            if (!lines)
+            {
+                simulator.resume(std::cin, std::cout);
+                if (!profileFile.empty())
+                {
+                    simulator.writeProfile(profileFile);
+                }
+                return;
+            }
+            if (!first)
+            {
+                std::cout << "\n";
+            }
+            first = false;
+            std::istringstream input(line);
+            simulator.resume(input, std::cout);
+            const std::vector<long> &executed = simulator.getExecutionCounts();
+            for (size_t address = 0; address < counts.size(); ++address)
+            {
+                counts[address] += executed[address];
+            }
+        }
+        if (!profileFile.empty())
+        {
+            Simulator::writeProfile(profileFile, counts);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " [-at base] prog.e [[-at base] prog.e ...] [-m words] [-prof prog.prof]\n"
+                  << "       " << argv[0] << " prog.e -checkpoint inputs -save prog.snap\n"
+                  << "       " << argv[0] << " -restore prog.snap [-lines] [-prof prog.prof]\n"
+                  << "       (restored profiles count only what runs after the checkpoint, summed over -lines runs)" << std::endl;
+        return 1;
+    }
+
+    std::vector<Placement> placements;
+    std::string profileFile;
+    std::string snapshotFile;
+    std::string restoreFile;
+    long checkpoint = -1;
+    bool lines = false;
+    int capacity = 1 << 20;
+    int base = -1;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-prof" && i + 1 < argc)
+        {
+            profileFile = argv[++i];
+        }
+        else if (arg == "-at" && i + 1 < argc)
+        {
+            base = std::stoi(argv[++i]); // Vale só para o próximo arquivo
+        }
+        else if (arg == "-checkpoint" && i + 1 < argc)
+        {
+            checkpoint = std::stol(argv[++i]); // Quantos valores de entrada ler antes do snapshot
+        }
+        else if (arg == "-save" && i + 1 < argc)
+        {
+            snapshotFile = argv[++i];
+        }
+        else if (arg == "-restore" && i + 1 < argc)
+        {
+            restoreFile = argv[++i];
+        }
+        else if (arg == "-lines")
+        {
+            lines = true;
+        }
+        else if (arg == "-m" && i + 1 < argc)
+        {
+            capacity = std::stoi(argv[++i]);
+        }
+        else if (!arg.empty() && arg[0] == '-')
+        {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return 1;
+        }
+        else
+        {
+            placements.push_back({arg, base});
+            base = -1;
+        }
+    }
+    if (!restoreFile.empty() ? !placements.empty() : placements.empty())
+    {
+        std::cerr << "Error: Give either executables or -restore" << std::endl;
+        return 1;
+    }
+    if ((checkpoint >= 0) != !snapshotFile.empty() || (checkpoint >= 0 && (placements.size() > 1 || placements[0].base > 0)))
+    {
+        std::cerr << "Error: -checkpoint and -save go together, with a single executable" << std::endl;
+        return 1;
+    }
+
+    try
+    {
+        if (!restoreFile.empty())
+        {
+            runRestored(restoreFile, lines, profileFile);
+            return 0;
+        }
+        if (placements.size() > 1 || placements[0].base > 0)
+        {
+            runPacked(placements, capacity, profileFile);
+            return 0;
+        }
+
+        // O executável binário é mapeado e roda como está; o de texto é lido para um vetor
+        const std::string &imageFile = placements[0].file;
+        std::unique_ptr<MappedExecutable> mapped;
+        std::unique_ptr<Simulator> owned;
+        if (Executable::isBinary(imageFile))
+        {
+            mapped = std::make_unique<MappedExecutable>(imageFile);
+            owned = std::make_unique<Simulator>(mapped->memory(), mapped->words());
+            owned->setEntryPoint(mapped->header().entry);
+        }
+        else
+        {
+            owned = std::make_unique<Simulator>(Simulator::loadImage(imageFile));
+        }
+        Simulator &simulator = *owned;
+        if (checkpoint >= 0)
+        {
+            if (!simulator.runUntilInput(std::cin, std::cout, checkpoint))
+            {
+                throw std::runtime_error("Error: Program stopped before reading " + std::to_string(checkpoint) + " inputs");
+            }
+            Snapshot::capture(simulator).save(snapshotFile);
+            return 0;
+        }
+        simulator.run(std::cin, std::cout);
+        if (!profileFile.empty())
+        {
+            simulator.writeProfile(profileFile);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,224 @@
+#include "simulator.h"
+#include "executable.h"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+Simulator::Simulator(const std::vector<int> &memory)
+    : image(memory), memory(image.data()), memorySize(static_cast<int>(image.size())), executionCounts(memory.size(), 0)
+{
+}
+
+Simulator::Simulator(int *memory, size_t words)
+    : memory(memory), memorySize(static_cast<int>(words)), executionCounts(words, 0)
+{
+}
+
+int &Simulator::at(int address)
+{
+    if (address < 0 || address >= memorySize)
+    {
+        throw std::runtime_error("Error: Memory access out of bounds: " + std::to_string(address));
+    }
+    return memory[address];
+}
+
+void Simulator::run(std::istream &input, std::ostream &output)
+{
+    setState({0, entryPoint, 0, 0, 0});
+    execute(input, output, -1);
+}
+
+bool Simulator::runUntilInput(std::istream &input, std::ostream &output, long inputs)
+{
+    setState({0, entryPoint, 0, 0, 0});
+    return !execute(input, output, inputs);
+}
+
+void Simulator::resume(std::istream &input, std::ostream &output)
+{
+    execute(input, output, -1);
+}
+
+bool Simulator::execute(std::istream &input, std::ostream &output, long pauseAtInput)
+{
+    while (true)
+    {
+        if (instructionCount >= maxSteps)
+        {
+            throw std::runtime_error("Error: Step limit reached at address " + std::to_string(pc));
+        }
+        int opcode = at(pc);
+        if (opcode == 12 && inputsRead == pauseAtInput)
+        {
+            return false; // Para antes do INPUT, sem contá-lo, para que a retomada o execute
+        }
+        executionCounts[pc]++;
+        instructionCount++;
+
+        switch (opcode)
+        {
+        case 1: // ADD
+            accumulator += at(at(pc + 1));
+            pc += 2;
+            break;
+        case 2: // SUB
+            accumulator -= at(at(pc + 1));
+            pc += 2;
+            break;
+        case 3: // MULT
+            accumulator *= at(at(pc + 1));
+            pc += 2;
+            break;
+        case 4: // DIV
+        {
+            int divisor = at(at(pc + 1));
+            if (divisor == 0)
+            {
+                throw std::runtime_error("Error: Division by zero at address " + std::to_string(pc));
+            }
+            accumulator /= divisor;
+            pc += 2;
+            break;
+        }
+        case 5: // JMP
+            pc = at(pc + 1);
+            break;
+        case 6: // JMPN
+            pc = accumulator < 0 ? at(pc + 1) : pc + 2;
+            break;
+        case 7: // JMPP
+            pc = accumulator > 0 ? at(pc + 1) : pc + 2;
+            break;
+        case 8: // JMPZ
+            pc = accumulator == 0 ? at(pc + 1) : pc + 2;
+            break;
+        case 9: // COPY
+            at(at(pc + 2)) = at(at(pc + 1));
+            pc += 3;
+            break;
+        case 10: // LOAD
+            accumulator = at(at(pc + 1));
+            pc += 2;
+            break;
+        case 11: // STORE
+            at(at(pc + 1)) = accumulator;
+            pc += 2;
+            break;
+        case 12: // INPUT
+        {
+            int value;
+            if (!(input >> value))
+            {
+                throw std::runtime_error("Error: Missing input value at address " + std::to_string(pc));
+            }
+            at(at(pc + 1)) = value;
+            inputsRead++;
+            pc += 2;
+            break;
+        }
+        case 13: // OUTPUT
+            output << at(at(pc + 1)) << std::endl;
+            outputsWritten++;
+            pc += 2;
+            break;
+        case 14: // STOP
+            return true;
+        default:
+            throw std::runtime_error("Error: Invalid opcode " + std::to_string(opcode) + " at address " + std::to_string(pc));
+        }
+    }
+}
+
+long Simulator::getInstructionCount() const
+{
+    return instructionCount;
+}
+
+const std::vector<long> &Simulator::getExecutionCounts() const
+{
+    return executionCounts;
+}
+
+SimulatorState Simulator::getState() const
+{
+    return {accumulator, pc, instructionCount, inputsRead, outputsWritten};
+}
+
+void Simulator::setState(const SimulatorState &state)
+{
+    accumulator = state.accumulator;
+    pc = state.pc;
+    instructionCount = state.instructionCount;
+    inputsRead = state.inputsRead;
+    outputsWritten = state.outputsWritten;
+}
+
+const int *Simulator::getMemory() const
+{
+    return memory;
+}
+
+size_t Simulator::getMemorySize() const
+{
+    return static_cast<size_t>(memorySize);
+}
+
+void Simulator::setMaxSteps(long steps)
+{
+    maxSteps = steps;
+}
+
+void Simulator::setEntryPoint(int address)
+{
+    entryPoint = address;
+}
+
+// Perfil de execução: uma linha "endereço contagem" para cada endereço executado
+void Simulator::writeProfile(const std::string &profileFile) const
+{
+    writeProfile(profileFile, executionCounts);
+}
+
+void Simulator::writeProfile(const std::string &profileFile, const std::vector<long> &counts)
+{
+    std::ofstream output(profileFile);
+    if (!output)
+    {
+        throw std::runtime_error("Error: Could not open profile file: " + profileFile);
+    }
+    for (size_t address = 0; address < counts.size(); ++address)
+    {
+        if (counts[address] > 0)
+        {
+            output << address << " " << counts[address] << std::endl;
+        }
+    }
+}
+
+// Lê um executável .e, binário ou de texto (números decimais separados por espaço, ignorando
+// tabelas ao final)
+std::vector<int> Simulator::loadImage(const std::string &imageFile)
+{
+    std::ifstream input(imageFile, std::ios::binary);
+    if (!input)
+    {
+        throw std::runtime_error("Error: Could not open executable: " + imageFile);
+    }
+    return loadImage(input);
+}
+
+std::vector<int> Simulator::loadImage(std::istream &input)
+{
+    if (Executable::isBinary(input))
+    {
+        return Executable::read(input).code;
+    }
+    std::vector<int> image;
+    int value;
+    while (input >> value)
+    {
+        image.push_back(value);
+    }
+    return image;
+}
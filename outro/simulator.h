@@ -0,0 +1,64 @@
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include <string>
+#include <vector>
+#include <istream>
+#include <ostream>
+
+// Estado do processador fora da memória; o cursor de E/S conta valores já lidos e escritos
+struct SimulatorState
+{
+    int accumulator = 0;
+    int pc = 0;
+    long instructionCount = 0;
+    long inputsRead = 0;
+    long outputsWritten = 0;
+};
+
+class Simulator
+{
+public:
+    explicit Simulator(const std::vector<int> &memory);
+    // Roda sobre uma memória de terceiros (por exemplo, um MappedExecutable), sem copiá-la
+    Simulator(int *memory, size_t words);
+    Simulator(const Simulator &) = delete; // A memória pode ser o buffer próprio
+    Simulator &operator=(const Simulator &) = delete;
+    void run(std::istream &input, std::ostream &output);
+    // Roda desde o início até a instrução INPUT que leria o valor de índice inputs; devolve false
+    // se o programa parar antes
+    bool runUntilInput(std::istream &input, std::ostream &output, long inputs);
+    // Continua do estado atual (depois de runUntilInput ou setState) até o STOP
+    void resume(std::istream &input, std::ostream &output);
+    SimulatorState getState() const;
+    void setState(const SimulatorState &state);
+    const int *getMemory() const;
+    size_t getMemorySize() const;
+    long getInstructionCount() const;
+    const std::vector<long> &getExecutionCounts() const;
+    void setMaxSteps(long steps);
+    void setEntryPoint(int address);
+    void writeProfile(const std::string &profileFile) const;
+    // Uma linha "endereço contagem" por endereço executado
+    static void writeProfile(const std::string &profileFile, const std::vector<long> &counts);
+    static std::vector<int> loadImage(const std::string &imageFile);
+    static std::vector<int> loadImage(std::istream &input);
+
+private:
+    int &at(int address);
+    bool execute(std::istream &input, std::ostream &output, long pauseAtInput); // false ao pausar
+
+    std::vector<int> image; // Cópia da memória quando o simulador é dono dela
+    int *memory;
+    int memorySize;
+    std::vector<long> executionCounts; // Quantas vezes cada endereço foi executado
+    int accumulator = 0;
+    int pc = 0;
+    int entryPoint = 0;
+    long instructionCount = 0;
+    long inputsRead = 0;
+    long outputsWritten = 0;
+    long maxSteps = 100000000;
+};
+
+#endif // SIMULATOR_H
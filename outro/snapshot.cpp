@@ -0,0 +1,181 @@
+#include "snapshot.h"
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    const char magic[4] = {'M', 'S', 'N', 'P'};
+
+    // write() pode escrever menos que o pedido; repete até terminar
+    bool writeAll(int descriptor, const char *data, size_t bytes, off_t offset)
+    {
+        while (bytes > 0)
+        {
+            ssize_t written = ::pwrite(descriptor, data, bytes, offset);
+            if (written <= 0)
+                return false;
+            data += written;
+            bytes -= static_cast<size_t>(written);
+            offset += written;
+        }
+        return true;
+    }
+
+    void writeSnapshot(int descriptor, const SnapshotHeader &header, const int *memory, const std::string &name)
+    {
+        size_t bytes = size_t(header.memoryWords) * sizeof(int32_t);
+        if (::ftruncate(descriptor, static_cast<off_t>(header.memoryOffset + bytes)) != 0 ||
+            !writeAll(descriptor, reinterpret_cast<const char *>(&header), sizeof(header), 0) ||
+            !writeAll(descriptor, reinterpret_cast<const char *>(memory), bytes, header.memoryOffset))
+            throw std::runtime_error("Error: Could not write snapshot: " + name);
+    }
+}
+
+SnapshotMemory::SnapshotMemory(int descriptor, size_t length, const SnapshotHeader &header)
+    : length(length), memoryOffset(header.memoryOffset), memoryWords(header.memoryWords)
+{
+    base = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, descriptor, 0);
+    if (base == MAP_FAILED)
+    {
+        base = nullptr;
+        throw std::runtime_error("Error: Could not map snapshot");
+    }
+}
+
+SnapshotMemory::~SnapshotMemory()
+{
+    if (base != nullptr)
+        ::munmap(base, length);
+}
+
+SnapshotMemory::SnapshotMemory(SnapshotMemory &&other) noexcept
+    : base(other.base), length(other.length), memoryOffset(other.memoryOffset), memoryWords(other.memoryWords)
+{
+    other.base = nullptr;
+}
+
+int *SnapshotMemory::memory()
+{
+    return reinterpret_cast<int *>(static_cast<char *>(base) + memoryOffset);
+}
+
+size_t SnapshotMemory::words() const
+{
+    return memoryWords;
+}
+
+Snapshot Snapshot::capture(const Simulator &simulator)
+{
+    SimulatorState state = simulator.getState();
+    SnapshotHeader header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.accumulator = state.accumulator;
+    header.pc = state.pc;
+    header.instructionCount = state.instructionCount;
+    header.inputsRead = state.inputsRead;
+    header.outputsWritten = state.outputsWritten;
+    header.memoryOffset = memoryOffset;
+    header.memoryWords = static_cast<uint32_t>(simulator.getMemorySize());
+
+    int descriptor = ::memfd_create("snapshot", MFD_CLOEXEC);
+    if (descriptor < 0)
+        throw std::runtime_error("Error: Could not create snapshot");
+    try
+    {
+        writeSnapshot(descriptor, header, simulator.getMemory(), "memory");
+    }
+    catch (...)
+    {
+        ::close(descriptor);
+        throw;
+    }
+    return Snapshot(descriptor, memoryOffset + size_t(header.memoryWords) * sizeof(int32_t), "memory");
+}
+
+Snapshot Snapshot::open(const std::string &file)
+{
+    int descriptor = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (descriptor < 0)
+        throw std::runtime_error("Error: Could not open snapshot: " + file);
+    struct stat status{};
+    if (::fstat(descriptor, &status) != 0)
+    {
+        ::close(descriptor);
+        throw std::runtime_error("Error: Could not open snapshot: " + file);
+    }
+    return Snapshot(descriptor, static_cast<size_t>(status.st_size), file);
+}
+
+// Confere o cabeçalho uma vez; as restaurações só mapeiam
+Snapshot::Snapshot(int descriptor, size_t length, const std::string &name)
+    : descriptor(descriptor), length(length)
+{
+    if (length < sizeof(SnapshotHeader) || ::pread(descriptor, &fields, sizeof(fields), 0) != sizeof(fields) ||
+        std::memcmp(fields.magic, magic, sizeof(magic)) != 0)
+    {
+        ::close(descriptor);
+        throw std::runtime_error("Error: Not a snapshot: " + name);
+    }
+    if (fields.version != version)
+    {
+        ::close(descriptor);
+        throw std::runtime_error("Error: Unsupported snapshot version " + std::to_string(fields.version) + ": " + name);
+    }
+    if (fields.memoryOffset < sizeof(SnapshotHeader) || fields.memoryOffset % 4096 != 0 ||
+        fields.memoryOffset + 4 * uint64_t(fields.memoryWords) > length || fields.pc < 0 || uint32_t(fields.pc) >= fields.memoryWords)
+    {
+        ::close(descriptor);
+        throw std::runtime_error("Error: Corrupt snapshot header: " + name);
+    }
+}
+
+Snapshot::~Snapshot()
+{
+    if (descriptor >= 0)
+        ::close(descriptor);
+}
+
+Snapshot::Snapshot(Snapshot &&other) noexcept
+    : descriptor(other.descriptor), length(other.length), fields(other.fields)
+{
+    other.descriptor = -1;
+}
+
+void Snapshot::save(const std::string &file) const
+{
+    int output = ::open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (output < 0)
+        throw std::runtime_error("Error: Could not open output file: " + file);
+    try
+    {
+        SnapshotMemory image = restore();
+        writeSnapshot(output, fields, image.memory(), file);
+    }
+    catch (...)
+    {
+        ::close(output);
+        throw;
+    }
+    ::close(output);
+}
+
+const SnapshotHeader &Snapshot::header() const
+{
+    return fields;
+}
+
+SimulatorState Snapshot::state() const
+{
+    return {fields.accumulator, fields.pc, static_cast<long>(fields.instructionCount), static_cast<long>(fields.inputsRead),
+            static_cast<long>(fields.outputsWritten)};
+}
+
+SnapshotMemory Snapshot::restore() const
+{
+    return SnapshotMemory(descriptor, length, fields);
+}
@@ -0,0 +1,78 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstdint>
+#include <string>
+#include "simulator.h"
+
+// Snapshot (.snap): cabeçalho de 64 bytes com o estado do processador e o cursor de E/S e,
+// a partir de memoryOffset (uma página de 4096 bytes), a memória inteira como palavras int32.
+// A memória começa alinhada à página para que cada restauração a mapeie com MAP_PRIVATE
+// e o kernel copie só as páginas que a execução escrever
+struct SnapshotHeader
+{
+    char magic[4];
+    uint32_t version;
+    int32_t accumulator;
+    int32_t pc;
+    int64_t instructionCount;
+    int64_t inputsRead;
+    int64_t outputsWritten;
+    uint32_t memoryOffset;
+    uint32_t memoryWords;
+    uint32_t reserved[4];
+};
+
+static_assert(sizeof(SnapshotHeader) == 64, "SnapshotHeader must stay 64 bytes");
+
+// Memória restaurada de um snapshot: mapeamento privado, as escritas não chegam ao snapshot
+class SnapshotMemory
+{
+public:
+    SnapshotMemory(int descriptor, size_t length, const SnapshotHeader &header);
+    ~SnapshotMemory();
+    SnapshotMemory(SnapshotMemory &&other) noexcept;
+    SnapshotMemory(const SnapshotMemory &) = delete;
+    SnapshotMemory &operator=(const SnapshotMemory &) = delete;
+    SnapshotMemory &operator=(SnapshotMemory &&) = delete;
+
+    int *memory();
+    size_t words() const;
+
+private:
+    void *base = nullptr;
+    size_t length = 0;
+    uint32_t memoryOffset = 0;
+    uint32_t memoryWords = 0;
+};
+
+// Ponto de retomada de uma simulação. capture() guarda o snapshot num arquivo anônimo em
+// memória (memfd), open() usa um arquivo salvo; em ambos, restore() custa um mmap
+class Snapshot
+{
+public:
+    static const uint32_t version = 1;
+    static const uint32_t memoryOffset = 4096;
+
+    static Snapshot capture(const Simulator &simulator);
+    static Snapshot open(const std::string &file);
+    ~Snapshot();
+    Snapshot(Snapshot &&other) noexcept;
+    Snapshot(const Snapshot &) = delete;
+    Snapshot &operator=(const Snapshot &) = delete;
+    Snapshot &operator=(Snapshot &&) = delete;
+
+    void save(const std::string &file) const;
+    const SnapshotHeader &header() const;
+    SimulatorState state() const;
+    SnapshotMemory restore() const;
+
+private:
+    Snapshot(int descriptor, size_t length, const std::string &name);
+
+    int descriptor = -1;
+    size_t length = 0;
+    SnapshotHeader fields{};
+};
+
+#endif // SNAPSHOT_H
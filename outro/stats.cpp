@@ -0,0 +1,315 @@
+#include "stats.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <utility>
+#include <vector>
+#include <sys/resource.h>
+
+namespace
+{
+    std::atomic<bool> active{false};
+    std::atomic<long> allocationCount{0};
+    std::atomic<long> allocationBytes{0};
+
+    // Poucas fases e contadores: vetores na ordem da primeira ocorrência, que é a ordem do pipeline
+    std::mutex statsMutex;
+    std::vector<std::pair<std::string, double>> phases;
+    std::vector<std::pair<std::string, long>> counters;
+
+    template <typename T>
+    T &entry(std::vector<std::pair<std::string, T>> &entries, const std::string &name)
+    {
+        for (auto &[key, value] : entries)
+        {
+            if (key == name)
+                return value;
+        }
+        entries.push_back({name, T()});
+        return entries.back().second;
+    }
+
+    // Fases de alocação em tabela fixa: o operator new só lê o índice da thread e soma
+    // atômicos, sem alocar nem travar. A posição 0 junta o que acontece fora de qualquer fase.
+    const int maximumPhases = 16;
+    const char *phaseNames[maximumPhases] = {"other"};
+    std::atomic<int> phaseCount{1};
+    std::atomic<long> phaseAllocations[maximumPhases];
+    std::atomic<long> phaseBytes[maximumPhases];
+    std::mutex phaseMutex;
+    thread_local int currentPhase = 0;
+
+    int phaseIndex(const char *name)
+    {
+        int count = phaseCount.load(std::memory_order_acquire);
+        for (int i = 1; i < count; ++i)
+        {
+            if (std::strcmp(phaseNames[i], name) == 0)
+                return i;
+        }
+        std::lock_guard<std::mutex> lock(phaseMutex);
+        count = phaseCount.load(std::memory_order_relaxed);
+        for (int i = 1; i < count; ++i)
+        {
+            if (std::strcmp(phaseNames[i], name) == 0)
+                return i;
+        }
+        if (count == maximumPhases)
+            return 0;
+        phaseNames[count] = name;
+        phaseCount.store(count + 1, std::memory_order_release);
+        return count;
+    }
+
+    // Alocador sobre malloc para as estruturas do rastreamento, que vivem dentro do operator new
+    // e não podem voltar a ele
+    template <typename T>
+    struct MallocAllocator
+    {
+        using value_type = T;
+        MallocAllocator() = default;
+        template <typename U>
+        MallocAllocator(const MallocAllocator<U> &) {}
+        T *allocate(std::size_t count)
+        {
+            if (void *memory = std::malloc(count * sizeof(T)))
+                return static_cast<T *>(memory);
+            throw std::bad_alloc();
+        }
+        void deallocate(T *memory, std::size_t) { std::free(memory); }
+        template <typename U>
+        bool operator==(const MallocAllocator<U> &) const { return true; }
+        template <typename U>
+        bool operator!=(const MallocAllocator<U> &) const { return false; }
+    };
+
+    // Locais de alocação: os quadros acima do operator new identificam quem alocou
+    struct AllocationSite
+    {
+        long count = 0;
+        long bytes = 0;
+        int phase = 0;
+    };
+    const int siteFrames = 6;
+    std::atomic<size_t> topSites{0};
+    std::mutex siteMutex;
+    using SiteKey = std::vector<void *, MallocAllocator<void *>>;
+    using SiteMap = std::map<SiteKey, AllocationSite, std::less<SiteKey>, MallocAllocator<std::pair<const SiteKey, AllocationSite>>>;
+    SiteMap *sites = nullptr;
+
+#if MONTADOR_ALLOCATION_STATS
+    void recordSite(std::size_t size)
+    {
+        void *frames[siteFrames + 1];
+        int depth = backtrace(frames, siteFrames + 1);
+        SiteKey key(frames + std::min(depth, 1), frames + depth);
+        std::lock_guard<std::mutex> lock(siteMutex);
+        if (sites == nullptr)
+        {
+            void *memory = std::malloc(sizeof(SiteMap));
+            if (memory == nullptr)
+                return;
+            sites = ::new (memory) SiteMap();
+        }
+        AllocationSite &site = (*sites)[key];
+        site.count++;
+        site.bytes += static_cast<long>(size);
+        site.phase = currentPhase;
+    }
+#endif
+
+    // Nome da função quando o símbolo é exportado (ligue com -rdynamic); senão, arquivo+deslocamento
+    std::string describe(void *address)
+    {
+        Dl_info info{};
+        if (dladdr(address, &info) == 0)
+            return "?";
+        std::ostringstream text;
+        if (info.dli_sname != nullptr)
+        {
+            int status = 0;
+            char *demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+            text << (status == 0 ? demangled : info.dli_sname);
+            std::free(demangled);
+        }
+        else
+        {
+            text << (info.dli_fname ? info.dli_fname : "?") << "+0x" << std::hex
+                 << reinterpret_cast<char *>(address) - reinterpret_cast<char *>(info.dli_fbase);
+        }
+        return text.str();
+    }
+
+    std::string escape(const std::string &text)
+    {
+        std::string result;
+        for (char ch : text)
+        {
+            if (ch == '"' || ch == '\\')
+                result += '\\';
+            result += ch;
+        }
+        return result;
+    }
+}
+
+#if MONTADOR_ALLOCATION_STATS
+// Contagem de alocações: substitui o operator new global; as formas de array delegam a esta.
+// Sem a instrumentação ligada, só uma leitura relaxada antes do malloc. Nenhuma das
+// substituições é expandida em linha, para o compilador não casar um new com um free
+[[gnu::noinline]] void *operator new(std::size_t size)
+{
+    if (active.load(std::memory_order_relaxed))
+    {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        allocationBytes.fetch_add(static_cast<long>(size), std::memory_order_relaxed);
+        phaseAllocations[currentPhase].fetch_add(1, std::memory_order_relaxed);
+        phaseBytes[currentPhase].fetch_add(static_cast<long>(size), std::memory_order_relaxed);
+        if (topSites.load(std::memory_order_relaxed) > 0)
+            recordSite(size);
+    }
+    if (void *memory = std::malloc(size == 0 ? 1 : size))
+        return memory;
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+[[gnu::noinline]] void operator delete(void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+#endif
+
+void Stats::enable()
+{
+    active = true;
+}
+
+bool Stats::enabled()
+{
+    return active.load(std::memory_order_relaxed);
+}
+
+void Stats::trackAllocationSites(size_t top)
+{
+    enable();
+    topSites = top;
+}
+
+void Stats::addTime(const std::string &phase, double milliseconds)
+{
+    if (!enabled())
+        return;
+    std::lock_guard<std::mutex> lock(statsMutex);
+    entry(phases, phase) += milliseconds;
+}
+
+void Stats::count(const std::string &counter, long value)
+{
+    if (!enabled())
+        return;
+    std::lock_guard<std::mutex> lock(statsMutex);
+    entry(counters, counter) += value;
+}
+
+long Stats::allocations()
+{
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+long Stats::allocatedBytes()
+{
+    return allocationBytes.load(std::memory_order_relaxed);
+}
+
+long Stats::peakRssKilobytes()
+{
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss; // Em KB no Linux
+}
+
+// {"phases_ms": {...}, "counters": {...}, "allocations_by_phase": {...}[, "allocation_sites": [...]]};
+// alocações e pico de memória entram como contadores
+void Stats::writeJson(std::ostream &output)
+{
+    long allocationsSoFar = allocations();
+    long bytesSoFar = allocatedBytes();
+    size_t top = topSites.exchange(0); // Nada do relatório em diante é rastreado
+    std::lock_guard<std::mutex> lock(statsMutex);
+    output << std::fixed << std::setprecision(3) << "{\"phases_ms\": {";
+    for (size_t i = 0; i < phases.size(); ++i)
+        output << (i == 0 ? "" : ", ") << "\"" << phases[i].first << "\": " << phases[i].second;
+    output << "}, \"counters\": {";
+    for (const auto &[name, value] : counters)
+        output << "\"" << name << "\": " << value << ", ";
+    output << "\"allocations\": " << allocationsSoFar << ", \"allocated_bytes\": " << bytesSoFar
+           << ", \"peak_rss_kb\": " << peakRssKilobytes() << "}, \"allocations_by_phase\": {";
+    bool first = true;
+    for (int i = 0; i < phaseCount.load(); ++i)
+    {
+        if (phaseAllocations[i] == 0)
+            continue;
+        output << (first ? "" : ", ") << "\"" << phaseNames[i] << "\": {\"count\": " << phaseAllocations[i]
+               << ", \"bytes\": " << phaseBytes[i] << "}";
+        first = false;
+    }
+    output << "}";
+
+    if (top > 0)
+    {
+        std::lock_guard<std::mutex> siteLock(siteMutex);
+        std::vector<std::pair<SiteKey, AllocationSite>> sorted;
+        if (sites != nullptr)
+            sorted.assign(sites->begin(), sites->end());
+        std::sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b)
+                  { return a.second.count > b.second.count; });
+        sorted.resize(std::min(top, sorted.size()));
+        output << ", \"allocation_sites\": [";
+        for (size_t i = 0; i < sorted.size(); ++i)
+        {
+            const auto &[frames, site] = sorted[i];
+            output << (i == 0 ? "" : ", ") << "{\"count\": " << site.count << ", \"bytes\": " << site.bytes
+                   << ", \"phase\": \"" << phaseNames[site.phase] << "\", \"frames\": [";
+            for (size_t f = 0; f < frames.size(); ++f)
+                output << (f == 0 ? "" : ", ") << "\"" << escape(describe(frames[f])) << "\"";
+            output << "]}";
+        }
+        output << "]";
+    }
+    output << "}" << std::endl;
+}
+
+PhaseScope::PhaseScope(const char *phase) : previous(currentPhase)
+{
+    if (Stats::enabled())
+        currentPhase = phaseIndex(phase);
+}
+
+PhaseScope::~PhaseScope()
+{
+    currentPhase = previous;
+}
+
+ScopedTimer::ScopedTimer(const char *phase) : phase(phase), start(std::chrono::steady_clock::now()), scope(phase)
+{
+}
+
+ScopedTimer::~ScopedTimer()
+{
+    if (Stats::enabled())
+        Stats::addTime(phase, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+}
@@ -0,0 +1,73 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <chrono>
+#include <ostream>
+#include <string>
+
+// Pontos de rastreamento de depuração: só existem quando compilados com -DMONTADOR_TRACE=1;
+// sem isso, o compilador remove a mensagem inteira, inclusive a montagem dos argumentos
+#ifndef MONTADOR_TRACE
+#define MONTADOR_TRACE 0
+#endif
+
+#define TRACE(stream, message)   \
+    do                           \
+    {                            \
+        if (MONTADOR_TRACE)      \
+            (stream) << message; \
+    } while (0)
+
+// Contagem de alocações: o operator new global só é substituído com MONTADOR_ALLOCATION_STATS=1
+// (o padrão) e, mesmo assim, não toca em nada compartilhado enquanto Stats::enable() não for
+// chamado; com 0, o operator new da biblioteca fica intocado e as alocações aparecem zeradas
+#ifndef MONTADOR_ALLOCATION_STATS
+#define MONTADOR_ALLOCATION_STATS 1
+#endif
+
+// Instrumentação de uma execução: tempo por fase e contadores, desligada até enable().
+// Pode ser usada de várias threads; cada fase soma o tempo de todas as chamadas.
+class Stats
+{
+public:
+    static void enable();
+    static bool enabled();
+    static void addTime(const std::string &phase, double milliseconds);
+    static void count(const std::string &counter, long value);
+    static void writeJson(std::ostream &output);
+
+    static long allocations();
+    static long allocatedBytes();
+    static long peakRssKilobytes();
+
+    // Guarda a pilha de cada alocação e lista no relatório os top locais que mais alocam.
+    // Opcional e caro: cada operator new passa a chamar backtrace()
+    static void trackAllocationSites(size_t top);
+};
+
+// Enquanto o escopo existir, as alocações desta thread contam para a fase indicada
+// (só com a instrumentação ligada; escopos aninhados restauram a fase anterior)
+class PhaseScope
+{
+public:
+    explicit PhaseScope(const char *phase);
+    ~PhaseScope();
+
+private:
+    int previous;
+};
+
+// Mede o tempo de vida do escopo e o soma à fase, à qual também atribui as alocações
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(const char *phase);
+    ~ScopedTimer();
+
+private:
+    const char *phase;
+    std::chrono::steady_clock::time_point start;
+    PhaseScope scope;
+};
+
+#endif // STATS_H
@@ -0,0 +1,258 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "assembler.h"
+#include "cfg.h"
+#include "constassembler.h"
+#include "preprocessor.h"
+#include "server.h"
+
+// Testes de regressão: cada caso roda no próprio processo, as falhas vão para stderr e o
+// código de saída é 1 se alguma falhar
+namespace
+{
+    int failures = 0;
+    std::filesystem::path scratch; // Diretório temporário dos casos que usam arquivos
+
+    void check(bool condition, const std::string &name)
+    {
+        if (!condition)
+        {
+            std::cerr << "FAIL: " << name << std::endl;
+            ++failures;
+        }
+    }
+
+    void writeFile(const std::filesystem::path &path, const std::string &content)
+    {
+        std::ofstream output(path);
+        output << content;
+    }
+
+    // A montagem em tempo de compilação precisa gerar o mesmo objeto que ./montador -o gera
+    // para este programa (palavras e REAL), CONST 010 decimal incluído
+    constexpr std::string_view embeddedCheckSource = R"(
+SECTION TEXT
+INPUT N
+LOAD N
+MULT DOIS
+STORE R + 1
+COPY R + 1, R
+OUTPUT R
+JMPP FIM
+ADD K
+FIM: STOP
+SECTION DATA
+DOIS: CONST 2
+K: CONST 010
+N: SPACE
+R: SPACE 2
+)";
+    constexpr auto embeddedCheck = assembleProgram<32, 8>(embeddedCheckSource);
+    constexpr int embeddedCheckWords[] = {12, 20, 10, 20, 3, 18, 11, 22, 9, 22, 21, 13, 21, 7, 17, 1, 19, 14, 2, 10, 0, 0, 0};
+    constexpr std::string_view embeddedCheckRelocation = "01010101011010101000000";
+
+    constexpr bool matchesEmbeddedCheck()
+    {
+        if (embeddedCheck.size != std::size(embeddedCheckWords) || embeddedCheck.textSize != 18)
+            return false;
+        for (size_t i = 0; i < embeddedCheck.size; ++i)
+        {
+            if (embeddedCheck.words[i] != embeddedCheckWords[i] || embeddedCheck.relocation[i] != embeddedCheckRelocation[i])
+                return false;
+        }
+        return true;
+    }
+    static_assert(matchesEmbeddedCheck(), "constassembler.h disagrees with the reference program");
+
+    // O mesmo programa pelo montador de tempo de execução
+    void testEmbeddedAssembler()
+    {
+        ObjectCode object = Assembler().assembleObject(embeddedCheckSource);
+        check(object.ok() && object.code == std::vector<int>(std::begin(embeddedCheckWords), std::end(embeddedCheckWords)),
+              "constassembler: words match Assembler");
+        check(object.relocation == embeddedCheckRelocation && object.textSize == embeddedCheck.textSize,
+              "constassembler: relocation and TEXT size match Assembler");
+    }
+
+    // Blocos [0, 6), [6, 10) e [10, 13); X = 13, Y = 14
+    void testDataflow()
+    {
+        ObjectCode object = Assembler().assembleObject(std::string_view(
+            "INPUT X\n"
+            "LOAD X\n"
+            "JMPZ FIM\n"
+            "STORE Y\n"
+            "LOAD Y\n"
+            "FIM: OUTPUT X\n"
+            "STOP\n"
+            "X: SPACE\n"
+            "Y: SPACE\n"));
+        ControlFlowGraph graph(object.code);
+        const std::vector<BasicBlock> &blocks = graph.getBlocks();
+        check(blocks.size() == 3 && blocks[1].start == 6 && blocks[2].start == 10, "cfg: blocks split at JMPZ and its target");
+        check(graph.getDataAddresses() == std::vector<int>({13, 14}), "cfg: SPACE words are data");
+
+        BlockSets liveIn, liveOut;
+        graph.liveness(liveIn, liveOut);
+        check(liveIn.members(0).empty() && liveOut.members(0) == std::vector<int>({13}), "liveness: INPUT X kills X before the block");
+        check(liveIn.members(1) == std::vector<int>({13}) && liveOut.members(1) == std::vector<int>({13}), "liveness: Y is written before it is read");
+        check(liveIn.members(2) == std::vector<int>({13}) && liveOut.members(2).empty(), "liveness: OUTPUT X reads X");
+
+        BlockSets reaching = graph.reachingDefinitions();
+        check(reaching.members(0).empty(), "reaching definitions: nothing reaches the entry");
+        check(reaching.members(1) == std::vector<int>({0}), "reaching definitions: INPUT X reaches the fall-through");
+        check(reaching.members(2) == std::vector<int>({0, 6}), "reaching definitions: both paths meet at FIM");
+        check(reaching.contains(2, 6) && !reaching.contains(1, 6), "reaching definitions: contains");
+    }
+
+    // EQU e INCLUDE no corpo de uma macro são tratados na expansão, não copiados para a saída
+    void testMacroDirectives()
+    {
+        std::filesystem::path directory = scratch / "macro";
+        std::filesystem::create_directories(directory);
+        writeFile(directory / "h.inc", "DOIS: EQU 2\n");
+        std::istringstream input(
+            "DEF: MACRO &N, &V\n"
+            "&N: EQU &V\n"
+            "INCLUDE \"h.inc\"\n"
+            "ENDMACRO\n"
+            "DEF T, 7\n"
+            "LOAD X\n"
+            "STOP\n"
+            "X: CONST T\n"
+            "Y: CONST DOIS\n");
+        std::ostringstream output;
+        Preprocessor preprocessor;
+        preprocessor.setIncludeDirectory(directory.string());
+        preprocessor.preprocess(input, output);
+        check(output.str() == "LOAD X\nSTOP\nX: CONST 7\nY: CONST 2\n", "macro: EQU and INCLUDE in the body are expanded");
+
+        ObjectCode object = Assembler().assembleObject(std::string_view(output.str()));
+        check(object.ok() && object.code == std::vector<int>({10, 3, 14, 7, 2}), "macro: expanded EQU assembles");
+    }
+
+    std::string preprocessError(const std::string &source)
+    {
+        std::istringstream input(source);
+        std::ostringstream output;
+        try
+        {
+            Preprocessor().preprocess(input, output);
+        }
+        catch (const std::exception &e)
+        {
+            return e.what();
+        }
+        return "";
+    }
+
+    // O valor de um EQU precisa caber em int; antes o excesso dava a volta sem aviso
+    void testEquRange()
+    {
+        std::string error = preprocessError("LOAD X\nX: EQU 3000000000\nSTOP\n");
+        check(error.find("Value out of range") != std::string::npos && error.find("line 2") != std::string::npos,
+              "equ: literal beyond int is rejected with its line (" + error + ")");
+        error = preprocessError("; comentário\n\nA: EQU 2000000000\nB: EQU A + A\n");
+        check(error.find("Value out of range for EQU B at line 4") != std::string::npos, "equ: overflowing expression is rejected (" + error + ")");
+        check(preprocessError("A: EQU 2147483647\nB: EQU -2147483647 - 1\n").empty(), "equ: int limits are accepted");
+    }
+
+    // A parte de símbolo de um operando precisa ser um rótulo válido, nos dois montadores
+    void testOperandSymbol()
+    {
+        for (const std::string operand : {"A B", "A$"})
+        {
+            ObjectCode object = Assembler().assembleObject(std::string_view("LOAD " + operand + "\nSTOP\nA: SPACE\n"));
+            bool invalid = !object.ok() && !object.diagnostics.empty() &&
+                           object.diagnostics[0].message.find("Invalid expression") != std::string::npos;
+            check(invalid, "operand: \"" + operand + "\" is an invalid expression");
+
+            std::string error;
+            try
+            {
+                assembleProgram("LOAD " + operand + "\nSTOP\nA: SPACE\n");
+            }
+            catch (const std::exception &e)
+            {
+                error = e.what();
+            }
+            check(error.find("Invalid expression") != std::string::npos, "constassembler: \"" + operand + "\" is an invalid expression");
+        }
+        check(Assembler().assembleObject(std::string_view("LOAD A + 1\nSTOP\nA: SPACE 2\n")).ok(), "operand: SIMBOLO op N still assembles");
+    }
+
+    // O cliente manda o diretório do fonte; o servidor roda noutro diretório de trabalho
+    void testServerInclude()
+    {
+        std::filesystem::path directory = scratch / "server";
+        std::filesystem::create_directories(directory);
+        writeFile(directory / "h.inc", "UM: EQU 1\n");
+        std::string source = "INCLUDE \"h.inc\"\nLOAD X\nSTOP\nX: CONST UM\n";
+        std::string socketPath = (scratch / "server.sock").string();
+
+        std::thread([socketPath]
+                    { Server(socketPath, 1).run(); })
+            .detach();
+        std::string response, error;
+        for (int attempt = 0; attempt < 100; ++attempt)
+        {
+            try
+            {
+                response = Server::request(socketPath, "preprocess", {source, directory.string()});
+                error.clear();
+                break;
+            }
+            catch (const std::exception &e)
+            {
+                error = e.what();
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            }
+        }
+        check(error.empty() && response == "LOAD X\nSTOP\nX: CONST 1\n", "server: INCLUDE resolved against the source directory (" + error + ")");
+
+        bool rejected = false;
+        try
+        {
+            Server::request(socketPath, "preprocess", {source, (scratch / "elsewhere").string()});
+        }
+        catch (const std::exception &e)
+        {
+            rejected = std::string(e.what()).find("h.inc") != std::string::npos;
+        }
+        check(rejected, "server: INCLUDE is not found in another directory");
+    }
+}
+
+int main()
+{
+    char directoryTemplate[] = "/tmp/testesXXXXXX";
+    if (::mkdtemp(directoryTemplate) == nullptr)
+    {
+        std::cerr << "Could not create a temporary directory" << std::endl;
+        return 1;
+    }
+    scratch = directoryTemplate;
+
+    testEmbeddedAssembler();
+    testDataflow();
+    testMacroDirectives();
+    testEquRange();
+    testOperandSymbol();
+    testServerInclude();
+    std::filesystem::remove_all(scratch);
+    if (failures > 0)
+    {
+        std::cerr << failures << " test(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All tests passed" << std::endl;
+    return 0;
+}
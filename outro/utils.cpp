@@ -13,7 +13,7 @@ std::string Utils::removeComments(const std::string &line)
 
 std::string Utils::removeExtraSpaces(const std::string &line)
 {
-    std::regex extraSpaces("\\s+");
+    static const std::regex extraSpaces("\\s+");
     return std::regex_replace(line, extraSpaces, " ");
 }
 
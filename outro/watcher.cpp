@@ -0,0 +1,226 @@
+#include "watcher.h"
+#include "preprocessor.h"
+#include "utils.h"
+#include <cerrno>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    std::string normalize(const std::string &path)
+    {
+        return fs::absolute(path).lexically_normal().string();
+    }
+
+    double elapsed(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+Watcher::Watcher(const std::vector<std::string> &sourceFiles, const std::string &executableFile, std::ostream &log)
+    : modules(sourceFiles.size()), executableFile(executableFile), log(log)
+{
+    for (size_t i = 0; i < sourceFiles.size(); ++i)
+    {
+        WatchedModule &module = modules[i];
+        module.sourceFile = sourceFiles[i];
+        module.preprocessedFile = Utils::replaceExtension(sourceFiles[i], ".pre");
+        module.objectFile = Utils::replaceExtension(sourceFiles[i], ".obj");
+        module.dependencies = {normalize(sourceFiles[i])};
+        module.assembler = std::make_unique<IncrementalAssembler>();
+    }
+    if (this->executableFile.empty() && modules.size() > 1)
+        this->executableFile = Utils::replaceExtension(sourceFiles[0], ".e");
+}
+
+void Watcher::buildAll()
+{
+    auto start = std::chrono::steady_clock::now();
+    for (auto &module : modules)
+        rebuild(module);
+    link();
+    log << "Initial build: " << elapsed(start) << " ms" << std::endl;
+}
+
+// Pré-processa e monta um módulo; cada etapa só grava sua saída quando ela muda
+bool Watcher::rebuild(WatchedModule &module)
+{
+    auto start = std::chrono::steady_clock::now();
+    try
+    {
+        std::ifstream input(module.sourceFile);
+        if (!input)
+            throw std::runtime_error("Error: Could not open input file: " + module.sourceFile);
+        std::ostringstream source;
+        bool preprocess = Utils::replaceExtension(module.sourceFile, ".asm") == module.sourceFile;
+        if (preprocess)
+        {
+            Preprocessor preprocessor;
+            preprocessor.setIncludeDirectory(fs::path(module.sourceFile).parent_path().string());
+            preprocessor.preprocess(input, source);
+            // Os arquivos incluídos passam a fazer parte do grafo do módulo
+            module.dependencies = {normalize(module.sourceFile)};
+            for (const auto &file : preprocessor.getIncludedFiles())
+                module.dependencies.push_back(file);
+        }
+        else
+        {
+            source << input.rdbuf();
+        }
+
+        double preprocessTime = elapsed(start);
+        if (source.str() == module.preprocessed && module.ok)
+        {
+            log << module.sourceFile << ": preprocessed output unchanged (" << preprocessTime << " ms)" << std::endl;
+            return false;
+        }
+        module.preprocessed = source.str();
+        if (preprocess)
+            std::ofstream(module.preprocessedFile) << module.preprocessed;
+
+        std::vector<std::string> lines;
+        std::istringstream preprocessed(module.preprocessed);
+        std::string line;
+        while (std::getline(preprocessed, line))
+            lines.push_back(line);
+
+        auto assembleStart = std::chrono::steady_clock::now();
+        ObjectCode object = module.assembler->assemble(lines);
+        for (const auto &diagnostic : object.diagnostics)
+        {
+            if (diagnostic.isError)
+                throw std::runtime_error(diagnostic.message);
+        }
+        std::ostringstream objectText;
+        Assembler::writeObject(object, objectText);
+        std::ofstream(module.objectFile) << objectText.str();
+        std::istringstream objectInput(objectText.str());
+        module.module = Linker::readModule(objectInput, module.objectFile);
+        module.ok = true;
+
+        const IncrementalStats &stats = module.assembler->getStats();
+        log << module.sourceFile << ": preprocess " << preprocessTime << " ms, assemble " << elapsed(assembleStart)
+            << " ms (" << stats.linesRelexed << " of " << lines.size() << " lines re-lexed)" << std::endl;
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        module.ok = false;
+        module.preprocessed.clear();
+        log << module.sourceFile << ": " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// Religa com os objetos em memória de todos os módulos
+void Watcher::link()
+{
+    if (executableFile.empty())
+        return;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Module> objects;
+    for (const auto &module : modules)
+    {
+        if (!module.ok)
+        {
+            log << "Link skipped: " << module.sourceFile << " has errors" << std::endl;
+            return;
+        }
+        objects.push_back(module.module);
+    }
+
+    try
+    {
+        Executable::write(Linker().linkExecutable(objects), executableFile);
+        log << "Linked " << executableFile << " in " << elapsed(start) << " ms" << std::endl;
+    }
+    catch (const std::exception &e)
+    {
+        log << "Link failed: " << e.what() << std::endl;
+    }
+}
+
+// Observa os diretórios (editores costumam salvar criando um arquivo novo e renomeando)
+void Watcher::watchDependencies()
+{
+    std::set<std::string> directories;
+    dependents.clear();
+    for (size_t i = 0; i < modules.size(); ++i)
+    {
+        for (const auto &dependency : modules[i].dependencies)
+        {
+            dependents[dependency].push_back(i);
+            directories.insert(fs::path(dependency).parent_path().string());
+        }
+    }
+    for (const auto &directory : directories)
+    {
+        bool watched = false;
+        for (const auto &[descriptor, path] : watchedDirectories)
+            watched = watched || path == directory;
+        if (watched)
+            continue;
+        int descriptor = inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        if (descriptor < 0)
+            throw std::runtime_error("Error: Could not watch directory: " + directory);
+        watchedDirectories[descriptor] = directory;
+    }
+}
+
+void Watcher::run()
+{
+    log << std::fixed << std::setprecision(3);
+    inotifyFd = inotify_init1(IN_CLOEXEC);
+    if (inotifyFd < 0)
+        throw std::runtime_error("Error: Could not initialize inotify");
+    buildAll();
+    watchDependencies();
+    log << "Watching " << dependents.size() << " files" << std::endl;
+
+    std::vector<char> buffer(64 * 1024);
+    while (true)
+    {
+        ssize_t length = ::read(inotifyFd, buffer.data(), buffer.size());
+        if (length < 0 && errno == EINTR)
+            continue;
+        // Um fd de inotify bloqueante nunca devolve 0: fim ou erro não se resolvem repetindo
+        if (length <= 0)
+            throw std::system_error(length < 0 ? errno : EIO, std::generic_category(), "Error: Could not read inotify events");
+        auto start = std::chrono::steady_clock::now();
+
+        // Todos os eventos lidos de uma vez formam uma única reconstrução
+        std::set<size_t> changed;
+        for (ssize_t offset = 0; offset < length;)
+        {
+            const inotify_event *event = reinterpret_cast<const inotify_event *>(buffer.data() + offset);
+            offset += sizeof(inotify_event) + event->len;
+            auto directory = watchedDirectories.find(event->wd);
+            if (directory == watchedDirectories.end() || event->len == 0)
+                continue;
+            auto it = dependents.find((fs::path(directory->second) / event->name).string());
+            if (it != dependents.end())
+                changed.insert(it->second.begin(), it->second.end());
+        }
+        if (changed.empty())
+            continue;
+
+        bool relink = false;
+        for (size_t index : changed)
+            relink = rebuild(modules[index]) || relink;
+        if (relink)
+            link();
+        watchDependencies();
+        log << "Rebuild finished in " << elapsed(start) << " ms" << std::endl;
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef WATCHER_H
+#define WATCHER_H
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "incremental.h"
+#include "linker.h"
+
+// Um módulo do grafo fonte -> .pre -> .obj, com o estado em memória de cada etapa
+struct WatchedModule
+{
+    std::string sourceFile;
+    std::string preprocessedFile;
+    std::string objectFile;
+    std::vector<std::string> dependencies; // Arquivos cuja alteração refaz o módulo
+    std::string preprocessed;
+    std::unique_ptr<IncrementalAssembler> assembler;
+    Module module; // Objeto já no formato do ligador
+    bool ok = false;
+};
+
+// Observa os fontes com inotify e refaz apenas as etapas afetadas por cada alteração;
+// com mais de um módulo (ou um executável pedido) o programa é religado em memória
+class Watcher
+{
+public:
+    Watcher(const std::vector<std::string> &sourceFiles, const std::string &executableFile, std::ostream &log);
+    void run();
+    void buildAll();
+
+private:
+    bool rebuild(WatchedModule &module);
+    void link();
+    void watchDependencies();
+
+    std::vector<WatchedModule> modules;
+    std::string executableFile;
+    std::ostream &log;
+    int inotifyFd = -1;
+    std::unordered_map<int, std::string> watchedDirectories;        // descritor inotify -> diretório
+    std::unordered_map<std::string, std::vector<size_t>> dependents; // arquivo -> módulos que dependem dele
+};
+
+#endif // WATCHER_H